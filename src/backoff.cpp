@@ -0,0 +1,19 @@
+#include "backoff.h"
+#include <algorithm>
+#include <cmath>
+
+Backoff::Backoff(double base, double max, std::uint64_t seed):
+    base(base),
+    max(max),
+    random(seed)
+{
+}
+
+double Backoff::next()
+{
+    // 2^k overflows nothing that matters once it is past max
+    const double cap = std::min(max, base * std::ldexp(1.0, static_cast<int>(std::min(attempt, 62u))));
+    ++attempt;
+    std::uniform_real_distribution<double> jitter(cap / 2, cap);
+    return jitter(random);
+}
@@ -0,0 +1,32 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <cstdint>
+#include <random>
+
+/**
+ * Delays between reconnect attempts: exponential with equal jitter.
+ *
+ * Attempt k waits between half and all of min(max, base * 2^k), picked
+ * uniformly. The random half keeps clients that lost the same broker from
+ * coming back in lockstep; the fixed half keeps any of them from retrying
+ * right away.
+ */
+class Backoff
+{
+public:
+    Backoff(double base, double max, std::uint64_t seed = std::random_device()());
+
+    // seconds to wait before the next attempt
+    double next();
+    void reset() { attempt = 0; }
+    unsigned attempts() const { return attempt; }
+
+private:
+    const double base;
+    const double max;
+    unsigned attempt = 0;
+    std::mt19937_64 random;
+};
+
+#endif // BACKOFF_H
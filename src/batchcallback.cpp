@@ -0,0 +1,76 @@
+#include "batchcallback.h"
+#include <algorithm>
+
+BatchCallback::BatchCallback(batch_handler handler, std::size_t max_size, double max_delay):
+    handler(std::move(handler)),
+    max_size(std::max<std::size_t>(max_size, 1)),
+    max_delay(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(max_delay)))
+{
+    batch.reserve(this->max_size);
+    flusher = std::thread(&BatchCallback::flush, this);
+}
+
+BatchCallback::~BatchCallback()
+{
+    stop();
+}
+
+void BatchCallback::message_arrived(mqtt::const_message_ptr msg)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    // late paho deliveries, the handler's targets may be gone
+    if (stopping)
+        return;
+    if (batch.empty()) {
+        first = std::chrono::steady_clock::now();
+        wake.notify_one();
+    }
+    batch.push_back(std::move(msg));
+    if (batch.size() >= max_size)
+        deliver(guard);
+}
+
+void BatchCallback::stop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if (stopping)
+        return;
+    stopping = true;
+    wake.notify_one();
+    guard.unlock();
+    flusher.join();
+
+    guard.lock();
+    if (!batch.empty())
+        deliver(guard);
+}
+
+void BatchCallback::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        if (batch.empty()) {
+            wake.wait(guard);
+            continue;
+        }
+        // a full batch may be taken meanwhile, the next one has its own deadline
+        const auto deadline = first + max_delay;
+        if (std::chrono::steady_clock::now() < deadline) {
+            wake.wait_until(guard, deadline);
+            continue;
+        }
+        deliver(guard);
+        guard.lock();
+    }
+}
+
+void BatchCallback::deliver(std::unique_lock<std::mutex> &guard)
+{
+    // lock order is always lock, then delivering
+    std::lock_guard<std::mutex> order(delivering);
+    std::vector<mqtt::const_message_ptr> ready;
+    ready.reserve(max_size);
+    ready.swap(batch);
+    guard.unlock();
+    handler(ready.data(), ready.size());
+}
@@ -0,0 +1,51 @@
+#ifndef BATCHCALLBACK_H
+#define BATCHCALLBACK_H
+
+#include <mqtt/callback.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * mqtt::callback that hands messages on in batches.
+ *
+ * message_arrived() only appends to the current batch. The batch handler
+ * gets it once it holds max_size messages, on the paho thread, or once its
+ * first message waited max_delay seconds, on a flusher thread. Batches are
+ * delivered one at a time and in arrival order, so downstream stages can
+ * take their locks once per batch instead of once per message.
+ */
+class BatchCallback : public virtual mqtt::callback
+{
+public:
+    using batch_handler = std::function<void(const mqtt::const_message_ptr *msgs, std::size_t n)>;
+
+    explicit BatchCallback(batch_handler handler, std::size_t max_size = 256, double max_delay = 0.005);
+    ~BatchCallback() override;
+
+    void message_arrived(mqtt::const_message_ptr msg) override;
+    // delivers what is gathered and stops the flusher, for good; later messages are dropped
+    void stop();
+
+private:
+    void flush();
+    void deliver(std::unique_lock<std::mutex> &guard);
+
+    batch_handler handler;
+    const std::size_t max_size;
+    const std::chrono::steady_clock::duration max_delay;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::vector<mqtt::const_message_ptr> batch;
+    std::chrono::steady_clock::time_point first;
+    // held from taking a batch until it is handled, which keeps batches in order
+    std::mutex delivering;
+    std::thread flusher;
+    bool stopping = false;
+};
+
+#endif // BATCHCALLBACK_H
@@ -0,0 +1,46 @@
+# Micro-benchmarks of the message path, built apart from the GUI:
+#   qmake && make && bin/mqtt-explorer-bench --benchmark_format=json
+TEMPLATE = app
+TARGET = mqtt-explorer-bench
+QT -= gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH = ../mqtt_paho/libs/
+INCLUDEPATH += ../mqtt_paho/headers/
+INCLUDEPATH += ..
+LIBS = -fPIC -lbenchmark_main -lbenchmark -lpthread -lpaho-mqttpp3 -lpaho-mqtt3a -lpaho-mqtt3as -lpaho-mqtt3c -lpaho-mqtt3cs
+
+DESTDIR=bin/ #Target file directory
+OBJECTS_DIR=build/ #Intermediate object files directory
+
+SOURCES += \
+    bench_decode.cpp \
+    bench_endtoend.cpp \
+    bench_export.cpp \
+    bench_message.cpp \
+    bench_queue.cpp \
+    bench_subscribe.cpp \
+    bench_topics.cpp \
+    fakebroker.cpp \
+    topicsets.cpp \
+    topicspace.cpp \
+    ../batchcallback.cpp \
+    ../capture.cpp \
+    ../concurrenttrie.cpp \
+    ../exporter.cpp \
+    ../ingestqueue.cpp \
+    ../lastvaluecache.cpp \
+    ../mqttpacket.cpp \
+    ../retainedclear.cpp \
+    ../seriespyramid.cpp \
+    ../subscriptions.cpp \
+    ../taskpool.cpp \
+    ../timingwheel.cpp \
+    ../topicstats.cpp \
+    ../topictree.cpp
+
+HEADERS += \
+    fakebroker.h \
+    topicsets.h \
+    topicspace.h
@@ -0,0 +1,81 @@
+#include "mqttpacket.h"
+#include "seriespyramid.h"
+#include "topicsets.h"
+#include <cmath>
+
+namespace {
+
+// QoS 0 PUBLISH packets of MQTT 3.1.1, back to back
+std::string encode_publishes(const std::vector<std::string> &topics, std::size_t payload)
+{
+    std::string stream;
+    MqttPublish publish;
+    publish.payload.assign(payload, 'x');
+    for (const std::string &topic : topics) {
+        publish.topic = topic;
+        stream += encode_publish(publish, 4);
+    }
+    return stream;
+}
+
+} // namespace
+
+// a captured stream fed in TCP segment sized pieces, as when reading a capture
+static void BM_StreamParsePublish(benchmark::State &state)
+{
+    const auto topics = traffic_topics(shape_arg(state), state.range(1));
+    const std::string stream = encode_publishes(topics, 64);
+    const std::size_t SEGMENT = 1460;
+    MqttPacket packet;
+    MqttPublish publish;
+    for (auto _ : state) {
+        MqttStreamParser parser;
+        for (std::size_t at = 0; at < stream.size(); at += SEGMENT) {
+            parser.feed(stream.data() + at, std::min(SEGMENT, stream.size() - at));
+            while (parser.next(packet))
+                benchmark::DoNotOptimize(parse_publish(packet, 4, publish));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * topics.size());
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_StreamParsePublish)->Apply(topic_sets)->Unit(benchmark::kMillisecond);
+
+static void BM_VarintRead(benchmark::State &state)
+{
+    const char bytes[] = {'\xff', '\xff', '\x7f'};
+    std::uint32_t value;
+    for (auto _ : state) {
+        const char *p = bytes;
+        benchmark::DoNotOptimize(read_varint(p, bytes + sizeof(bytes), value));
+    }
+}
+BENCHMARK(BM_VarintRead);
+
+// one plotted topic receiving samples, including growing the coarser levels
+static void BM_SeriesAppend(benchmark::State &state)
+{
+    SeriesPyramid series;
+    double t = 0;
+    for (auto _ : state) {
+        series.append(t, std::sin(t));
+        t += 0.001;
+        if (series.size() >= static_cast<std::size_t>(state.range(0))) {
+            state.PauseTiming();
+            series.clear();
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SeriesAppend)->Arg(1 << 16)->Arg(1 << 22);
+
+static void BM_SeriesMinMax(benchmark::State &state)
+{
+    SeriesPyramid series;
+    for (std::int64_t i = 0; i < state.range(0); ++i)
+        series.append(i * 0.001, std::sin(i * 0.001));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(series.min_max(series.first_time(), series.last_time(), 1920));
+}
+BENCHMARK(BM_SeriesMinMax)->Arg(1 << 16)->Arg(1 << 22);
@@ -0,0 +1,171 @@
+#include <benchmark/benchmark.h>
+#include <mqtt/async_client.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "batchcallback.h"
+#include "fakebroker.h"
+#include "ingestqueue.h"
+#include "topicspace.h"
+#include "topictree.h"
+
+namespace {
+
+const std::size_t TOPICS = 10000;
+const double SECONDS = 1;
+// what the GUI timer of MainMenu drains per tick
+const std::size_t DRAIN_PER_TICK = 20000;
+const auto TICK = std::chrono::milliseconds(16);
+// later than this after the broker is done counts as lagging
+const double MAX_LAG = 0.1;
+
+struct Result
+{
+    double offered = 0;
+    double achieved = 0;
+    double lag = 0;
+    std::uint64_t delivered = 0;
+    IngestQueue::Counters counters;
+
+    bool sustained() const
+    {
+        return achieved >= 0.95 * offered && lag <= MAX_LAG && counters.shed == 0;
+    }
+};
+
+/*
+ * The explorer's message path without the widgets: paho client, batch
+ * callback, ingest queue, and a drain thread standing in for the GUI timer
+ * that records into a TopicTree.
+ */
+class Pipeline
+{
+public:
+    explicit Pipeline(FakeBroker &broker):
+        client(broker.address(), "bench"),
+        batches([this](const mqtt::const_message_ptr *msgs, std::size_t n) {
+            ingest.put(msgs, n);
+            delivered += n;
+        })
+    {
+        drainer = std::thread([this] {
+            std::vector<LastValueCache::Update> drained;
+            while (!stopping) {
+                std::this_thread::sleep_for(TICK);
+                drained.clear();
+                ingest.drain(drained, DRAIN_PER_TICK);
+                for (auto &update : drained)
+                    tree.record(std::move(update.msg), 0);
+                recorded += drained.size();
+            }
+        });
+        client.set_callback(batches);
+        mqtt::connect_options options;
+        options.set_clean_session(true);
+        client.connect(options)->wait();
+        client.subscribe("#", 0)->wait();
+        broker.wait_subscribed(5);
+    }
+
+    ~Pipeline()
+    {
+        client.disconnect()->wait();
+        batches.stop();
+        stopping = true;
+        drainer.join();
+    }
+
+    // waits until everything sent arrived and the queue is empty; seconds taken
+    double settle(std::uint64_t sent, double timeout)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        while ((delivered < sent || ingest.size() > 0) && elapsed < timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        return elapsed;
+    }
+
+    mqtt::async_client client;
+    IngestQueue ingest;
+    TopicTree tree;
+    std::atomic<std::uint64_t> delivered{0};
+    std::atomic<std::uint64_t> recorded{0};
+
+private:
+    std::atomic<bool> stopping{false};
+    std::thread drainer;
+    // last member: stops delivering before the queue goes away
+    BatchCallback batches;
+};
+
+// a fleet namespace; its retained set is delivered on every subscribe
+std::vector<MqttPublish> fleet(FakeBroker &broker, std::size_t &retained)
+{
+    TopicSpace::Config config;
+    config.topics = TOPICS;
+    TopicSpace space(config);
+    const std::vector<MqttPublish> burst = space.retained();
+    for (const MqttPublish &publish : burst)
+        broker.retain(publish);
+    retained = burst.size();
+    return space.traffic(10 * TOPICS);
+}
+
+Result run(FakeBroker &broker, const std::vector<MqttPublish> &messages, std::size_t retained, double rate)
+{
+    Pipeline pipeline(broker);
+    const FakeBroker::Stream stream = broker.stream(messages, rate, SECONDS);
+    Result result;
+    result.offered = rate;
+    result.achieved = stream.seconds > 0 ? stream.sent / stream.seconds : 0;
+    result.lag = pipeline.settle(retained + stream.sent, 2);
+    result.delivered = pipeline.delivered;
+    result.counters = pipeline.ingest.counters();
+    return result;
+}
+
+void report(benchmark::State &state, const Result &result)
+{
+    state.counters["offered_per_s"] = result.offered;
+    state.counters["achieved_per_s"] = result.achieved;
+    state.counters["lag_ms"] = result.lag * 1000;
+    state.counters["delivered"] = static_cast<double>(result.delivered);
+    state.counters["conflated"] = static_cast<double>(result.counters.conflated);
+    state.counters["shed"] = static_cast<double>(result.counters.shed);
+}
+
+} // namespace
+
+// one second at a fixed offered rate, range(0) messages per second
+static void BM_EndToEnd(benchmark::State &state)
+{
+    FakeBroker broker;
+    std::size_t retained;
+    const auto messages = fleet(broker, retained);
+    for (auto _ : state)
+        report(state, run(broker, messages, retained, static_cast<double>(state.range(0))));
+}
+BENCHMARK(BM_EndToEnd)->Arg(10000)->Arg(50000)->Arg(200000)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// doubles the offered rate until the explorer falls behind or sheds, and
+// reports the last rate it kept up with as sustained_per_s
+static void BM_EndToEndSustained(benchmark::State &state)
+{
+    FakeBroker broker;
+    std::size_t retained;
+    const auto messages = fleet(broker, retained);
+    for (auto _ : state) {
+        Result last;
+        for (double rate = 10000;; rate *= 2) {
+            const Result result = run(broker, messages, retained, rate);
+            if (!result.sustained())
+                break;
+            last = result;
+        }
+        report(state, last);
+        state.counters["sustained_per_s"] = last.offered;
+    }
+}
+BENCHMARK(BM_EndToEndSustained)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
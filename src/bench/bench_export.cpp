@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include "capture.h"
+#include "exporter.h"
+#include "topicsets.h"
+
+namespace {
+
+const char *const FORMATS[] = {"csv", "ndjson", "columnar"};
+
+std::string temp_path(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// removed again when the benchmarks exit
+struct TempCapture
+{
+    std::string path = temp_path("mqtt-explorer-bench.mqcap");
+    std::size_t records = 0;
+    ~TempCapture() { std::remove(path.c_str()); }
+};
+
+// `records` messages of fleet traffic with printable 64 byte payloads, written once per size
+const std::string &capture_of(std::size_t records)
+{
+    static TempCapture capture;
+    if (capture.records != records) {
+        const auto topics = traffic_topics(TopicShape::Fleet, 100000);
+        const std::string payload(64, 'x');
+        CaptureWriter writer(capture.path);
+        for (std::size_t i = 0; i < records; ++i)
+            writer.write(i * 0.001, topics[i % topics.size()], payload.data(), payload.size(), 0, false);
+        writer.flush();
+        capture.records = records;
+    }
+    return capture.path;
+}
+
+} // namespace
+
+// a whole capture through the shared TaskPool into each format, the output stays in the page cache
+static void BM_Export(benchmark::State &state)
+{
+    const ExportFormat format = static_cast<ExportFormat>(state.range(0));
+    state.SetLabel(FORMATS[state.range(0)]);
+    const std::string &capture = capture_of(static_cast<std::size_t>(state.range(1)));
+    const std::string output = temp_path("mqtt-explorer-bench.export");
+    ExportStats stats;
+    for (auto _ : state)
+        stats = export_capture(capture, output, format);
+    std::remove(output.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(stats.records));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(stats.bytes));
+}
+BENCHMARK(BM_Export)
+    ->ArgNames({"format", "records"})
+    ->ArgsProduct({{0, 1, 2}, {2000000}})
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,55 @@
+#include <mqtt/buffer_ref.h>
+#include "topicsets.h"
+
+static void BM_BinaryRefCopy(benchmark::State &state)
+{
+    mqtt::binary_ref payload(std::string(state.range(0), 'x'));
+    for (auto _ : state) {
+        mqtt::binary_ref copy = payload;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_BinaryRefCopy)->Arg(16)->Arg(4096)->Arg(1 << 20);
+
+// there and back, a moved-from ref is empty
+static void BM_BinaryRefMove(benchmark::State &state)
+{
+    mqtt::binary_ref payload(std::string(state.range(0), 'x'));
+    for (auto _ : state) {
+        mqtt::binary_ref moved = std::move(payload);
+        benchmark::DoNotOptimize(moved);
+        payload = std::move(moved);
+    }
+}
+BENCHMARK(BM_BinaryRefMove)->Arg(16)->Arg(4096)->Arg(1 << 20);
+
+// what the paho callback does per delivery: copies topic and payload
+static void BM_MessageCreate(benchmark::State &state)
+{
+    const auto topics = traffic_topics(shape_arg(state), state.range(1));
+    const std::string payload(64, 'x');
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt::message::create(topics[i], payload.data(), payload.size(), 0, false));
+        if (++i == topics.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageCreate)->Apply(topic_sets);
+
+// topic and payload already shared, e.g. when resolving a topic alias
+static void BM_MessageCreateShared(benchmark::State &state)
+{
+    const auto topics = traffic_topics(shape_arg(state), state.range(1));
+    std::vector<mqtt::string_ref> refs(topics.begin(), topics.end());
+    const mqtt::binary_ref payload(std::string(64, 'x'));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt::message::create(refs[i], payload, 0, false));
+        if (++i == refs.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageCreateShared)->Apply(topic_sets);
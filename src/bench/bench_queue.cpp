@@ -0,0 +1,68 @@
+#include <mqtt/thread_queue.h>
+#include "ingestqueue.h"
+#include "topicsets.h"
+
+// one thread puts, the other gets; every thread runs the same number of
+// iterations, so the queue is empty again when a run ends. Only one of each:
+// the paho 1.2 queue only notifies on the empty and full transitions, so a
+// second waiting consumer or producer can miss its wakeup and hang the run
+static void BM_ThreadQueuePutGet(benchmark::State &state)
+{
+    static mqtt::thread_queue<mqtt::const_message_ptr> queue(1024);
+    const mqtt::const_message_ptr msg = mqtt::message::create("bench/topic", "payload", 7, 0, false);
+    const bool producer = state.thread_index() == 0;
+    for (auto _ : state) {
+        if (producer)
+            queue.put(msg);
+        else
+            benchmark::DoNotOptimize(queue.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadQueuePutGet)->Threads(2)->UseRealTime();
+
+// the paho thread putting batches while the GUI drains, as in MainMenu
+static void BM_IngestQueueLatest(benchmark::State &state)
+{
+    const auto msgs = make_traffic(shape_arg(state), state.range(1), 64);
+    IngestQueue queue;
+    std::vector<LastValueCache::Update> out;
+    std::size_t i = 0;
+    std::int64_t processed = 0;
+    for (auto _ : state) {
+        const std::size_t n = std::min<std::size_t>(256, msgs.size() - i);
+        queue.put(msgs.data() + i, n);
+        processed += n;
+        i = (i + n) % msgs.size();
+        if (i == 0) {
+            out.clear();
+            queue.drain(out, msgs.size());
+        }
+    }
+    state.SetItemsProcessed(processed);
+}
+BENCHMARK(BM_IngestQueueLatest)->Apply(topic_sets);
+
+// the longest prefix lookup of every message shed by the Priority policy
+static void BM_PriorityMatch(benchmark::State &state)
+{
+    const auto msgs = make_traffic(shape_arg(state), state.range(1), 16);
+    IngestQueue queue(1);
+    queue.set_policy(IngestQueue::Policy::Priority);
+    std::vector<std::pair<std::string, int>> priorities;
+    for (int i = 0; i < 16; ++i)
+        priorities.emplace_back("devices/" + std::to_string(i * 7) + "/", 1);
+    priorities.emplace_back("l0_1/l1_2/", 1);
+    queue.set_priorities(std::move(priorities));
+    // over twice the capacity, from here on every message is matched and shed
+    queue.put(msgs[0]);
+    queue.put(msgs[0]);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        queue.put(msgs[i]);
+        if (++i == msgs.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PriorityMatch)->Apply(topic_sets);
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <mqtt/async_client.h>
+#include <chrono>
+#include <thread>
+#include "fakebroker.h"
+#include "retainedclear.h"
+#include "subscriptions.h"
+#include "topicsets.h"
+
+namespace {
+
+// round trip to a remote broker, the fake broker holds every reply back this long
+const double ROUND_TRIP = 0.02;
+
+std::unique_ptr<mqtt::async_client> connect(FakeBroker &broker)
+{
+    auto client = std::make_unique<mqtt::async_client>(broker.address(), "bench");
+    mqtt::connect_options options;
+    options.set_clean_session(true);
+    client->connect(options)->wait();
+    return client;
+}
+
+void report(benchmark::State &state, double seconds, const char *what = "filters")
+{
+    state.SetIterationTime(seconds);
+    state.counters["round_trips"] = seconds / ROUND_TRIP;
+    state.counters[what] = static_cast<double>(state.range(0));
+}
+
+} // namespace
+
+// one SUBSCRIBE per filter, each awaited before the next, as display_topics() used to
+static void BM_SubscribeSerial(benchmark::State &state)
+{
+    FakeBroker broker;
+    broker.set_delay(ROUND_TRIP);
+    const auto filters = make_topics(TopicShape::Fleet, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto client = connect(broker);
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string &filter : filters)
+            client->subscribe(filter, 0)->wait();
+        report(state, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        client->disconnect()->wait();
+    }
+}
+BENCHMARK(BM_SubscribeSerial)->Arg(50)->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// the same filters packed and pipelined by SubscriptionManager
+static void BM_SubscribeManager(benchmark::State &state)
+{
+    FakeBroker broker;
+    broker.set_delay(ROUND_TRIP);
+    std::vector<SubscriptionManager::Filter> wanted;
+    for (std::string &filter : make_topics(TopicShape::Fleet, static_cast<std::size_t>(state.range(0))))
+        wanted.push_back(SubscriptionManager::Filter{std::move(filter), 0, {}});
+    for (auto _ : state) {
+        auto client = connect(broker);
+        SubscriptionManager manager;
+        manager.connected(*client);
+        const auto start = std::chrono::steady_clock::now();
+        manager.set(wanted);
+        while (!manager.idle())
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        report(state, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        state.counters["granted"] = static_cast<double>(manager.counters().granted);
+        client->disconnect()->wait();
+    }
+}
+BENCHMARK(BM_SubscribeManager)->Arg(200)->Arg(10000)->Iterations(3)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// one empty retained message per topic, each awaited before the next
+static void BM_ClearRetainedSerial(benchmark::State &state)
+{
+    FakeBroker broker;
+    broker.set_delay(ROUND_TRIP);
+    const auto topics = make_topics(TopicShape::Fleet, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto client = connect(broker);
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string &topic : topics)
+            client->publish(topic, nullptr, 0, 1, true)->wait();
+        report(state, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), "topics");
+        client->disconnect()->wait();
+    }
+}
+BENCHMARK(BM_ClearRetainedSerial)->Arg(50)->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// the same through RetainedClear, range(1) deletes outstanding at a time
+static void BM_ClearRetainedWindow(benchmark::State &state)
+{
+    FakeBroker broker;
+    broker.set_delay(ROUND_TRIP);
+    const auto topics = make_topics(TopicShape::Fleet, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto client = connect(broker);
+        RetainedClear clear;
+        const auto start = std::chrono::steady_clock::now();
+        clear.start(*client, topics, static_cast<std::size_t>(state.range(1)));
+        while (clear.progress().running)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        report(state, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), "topics");
+        const RetainedClear::Progress p = clear.progress();
+        state.counters["acknowledged"] = static_cast<double>(p.acknowledged);
+        state.counters["per_second"] = p.acknowledged / p.seconds;
+        client->disconnect()->wait();
+    }
+}
+BENCHMARK(BM_ClearRetainedWindow)->Args({20000, 16})->Args({20000, 256})->Args({20000, 1024})
+    ->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
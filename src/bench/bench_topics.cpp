@@ -0,0 +1,183 @@
+#include <algorithm>
+#include "concurrenttrie.h"
+#include "lastvaluecache.h"
+#include "topictree.h"
+#include "topicsets.h"
+
+// a whole tree per iteration, one message for every topic of the namespace
+static void BM_TopicTreeInsert(benchmark::State &state)
+{
+    const auto msgs = make_messages(make_topics(shape_arg(state), state.range(1)), 16);
+    for (auto _ : state) {
+        TopicTree tree;
+        for (const auto &msg : msgs)
+            tree.record(msg, 0);
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * msgs.size());
+}
+BENCHMARK(BM_TopicTreeInsert)->Apply(topic_sets)->Unit(benchmark::kMillisecond);
+
+// the steady state: every message is for a known topic
+static void BM_TopicTreeRecord(benchmark::State &state)
+{
+    const auto msgs = make_traffic(shape_arg(state), state.range(1), 16);
+    TopicTree tree;
+    for (const auto &msg : msgs)
+        tree.record(msg, 0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.record(msgs[i], 1));
+        if (++i == msgs.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicTreeRecord)->Apply(topic_sets);
+
+static void BM_TopicTreeFind(benchmark::State &state)
+{
+    const auto topics = make_topics(shape_arg(state), state.range(1));
+    TopicTree tree;
+    for (const auto &msg : make_messages(topics, 16))
+        tree.record(msg, 0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.find(topics[i]));
+        if (++i == topics.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicTreeFind)->Apply(topic_sets);
+
+// one expiry tick in the steady state: the oldest 1/400 of the topics come due
+// and are recorded again, the rest of the tree is not looked at
+static void BM_TopicTreeExpire(benchmark::State &state)
+{
+    const double IDLE = 100, TICK = 0.25;
+    const auto msgs = make_messages(make_topics(shape_arg(state), state.range(1)), 16);
+    const std::size_t per_tick = std::max<std::size_t>(msgs.size() * TICK / IDLE, 1);
+    TopicTree tree;
+    tree.set_idle_expiry(IDLE);
+    double now = stats_clock();
+    for (std::size_t i = 0; i < msgs.size(); ++i)
+        tree.record(msgs[i], now + IDLE * i / msgs.size());
+    now += IDLE;
+    std::size_t next = 0, expired = 0;
+    for (auto _ : state) {
+        now += TICK;
+        expired += tree.expire(now);
+        for (std::size_t i = 0; i < per_tick; ++i, next = (next + 1) % msgs.size())
+            tree.record(msgs[next], now);
+    }
+    state.counters["expired_per_tick"] = benchmark::Counter(static_cast<double>(expired) / state.iterations());
+    state.counters["topics"] = static_cast<double>(msgs.size());
+}
+BENCHMARK(BM_TopicTreeExpire)->Apply(topic_sets);
+
+static void BM_ConcurrentTrieInsert(benchmark::State &state)
+{
+    const auto msgs = make_messages(make_topics(shape_arg(state), state.range(1)), 16);
+    for (auto _ : state) {
+        ConcurrentTopicTrie trie;
+        for (const auto &msg : msgs)
+            trie.update(msg);
+        benchmark::DoNotOptimize(trie.size());
+    }
+    state.SetItemsProcessed(state.iterations() * msgs.size());
+}
+BENCHMARK(BM_ConcurrentTrieInsert)->Apply(topic_sets)->Unit(benchmark::kMillisecond);
+
+// readers on all threads against one shared, filled trie
+static void BM_ConcurrentTrieFind(benchmark::State &state)
+{
+    static ConcurrentTopicTrie *trie;
+    const auto topics = make_topics(shape_arg(state), state.range(1));
+    if (state.thread_index() == 0) {
+        trie = new ConcurrentTopicTrie;
+        for (const auto &msg : make_messages(topics, 16))
+            trie->update(msg);
+    }
+    std::size_t i = state.thread_index() * 7919 % topics.size();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(trie->find(topics[i]));
+        if (++i == topics.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+        delete trie;
+}
+BENCHMARK(BM_ConcurrentTrieFind)->Apply(topic_sets)->ThreadRange(1, 4)->UseRealTime();
+
+// writers on all threads, each adding every threads()-th topic of the namespace
+// to one fresh trie; a single pass, so the time is that of the inserts alone
+static void BM_ConcurrentTrieInsertThreads(benchmark::State &state)
+{
+    static ConcurrentTopicTrie *trie;
+    static std::vector<mqtt::const_message_ptr> msgs;
+    if (state.thread_index() == 0) {
+        msgs = make_messages(make_topics(shape_arg(state), state.range(1)), 16);
+        trie = new ConcurrentTopicTrie;
+    }
+    std::size_t inserted = 0;
+    for (auto _ : state) {
+        for (std::size_t i = state.thread_index(); i < msgs.size(); i += state.threads(), ++inserted)
+            trie->update(msgs[i]);
+    }
+    state.SetItemsProcessed(inserted);
+    if (state.thread_index() == 0) {
+        state.counters["topic_levels"] = static_cast<double>(trie->size());
+        delete trie;
+        msgs.clear();
+    }
+}
+BENCHMARK(BM_ConcurrentTrieInsertThreads)
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        b->ArgNames({"shape", "topics"});
+        b->ArgsProduct({{0, 1, 2, 3, 4}, {1000000}});
+    })
+    ->ThreadRange(1, 16)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// writers on all threads updating known topics of one shared trie, as the
+// delivering threads do once the namespace is known
+static void BM_ConcurrentTrieUpdateThreads(benchmark::State &state)
+{
+    static ConcurrentTopicTrie *trie;
+    // every thread builds the same topics, only thread 0 fills the trie
+    const auto msgs = make_messages(make_topics(shape_arg(state), state.range(1)), 16);
+    if (state.thread_index() == 0) {
+        trie = new ConcurrentTopicTrie;
+        for (const auto &msg : msgs)
+            trie->update(msg);
+    }
+    std::size_t i = state.thread_index() * 7919 % msgs.size();
+    for (auto _ : state) {
+        trie->update(msgs[i]);
+        if (++i == msgs.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+        delete trie;
+}
+BENCHMARK(BM_ConcurrentTrieUpdateThreads)->Apply(topic_sets)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_LastValueCachePut(benchmark::State &state)
+{
+    const auto msgs = make_traffic(shape_arg(state), state.range(1), 16);
+    LastValueCache cache;
+    std::vector<LastValueCache::Update> out;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.put(msgs[i]));
+        if (++i == msgs.size()) {
+            i = 0;
+            out.clear();
+            cache.drain(out, msgs.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LastValueCachePut)->Apply(topic_sets);
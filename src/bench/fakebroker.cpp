@@ -0,0 +1,363 @@
+#include "fakebroker.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+const std::size_t WRITE_CHUNK = 64 * 1024;
+
+std::string connack(int version)
+{
+    // no session present, accepted; MQTT 5 adds an empty property list
+    return encode_packet(MqttPacketType::Connack, 0, version >= 5 ? std::string(3, '\0') : std::string(2, '\0'));
+}
+
+// "#" only as the last level, "+" only as a whole level
+bool valid_filter(const std::string &filter)
+{
+    if (filter.empty())
+        return false;
+    for (std::size_t i = 0; i < filter.size(); ++i) {
+        if (filter[i] != '#' && filter[i] != '+')
+            continue;
+        const bool level_start = i == 0 || filter[i - 1] == '/';
+        const bool level_end = i + 1 == filter.size() || filter[i + 1] == '/';
+        if (!level_start || !level_end || (filter[i] == '#' && i + 1 != filter.size()))
+            return false;
+    }
+    return true;
+}
+
+std::string packet_id_body(std::uint16_t packet_id)
+{
+    std::string body;
+    body += static_cast<char>(packet_id >> 8);
+    body += static_cast<char>(packet_id & 0xff);
+    return body;
+}
+
+} // namespace
+
+FakeBroker::FakeBroker(std::uint16_t port)
+{
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::runtime_error("cannot create the broker socket");
+    const int on = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t size = sizeof(addr);
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+            || ::listen(listener, 4) != 0
+            || ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &size) != 0) {
+        ::close(listener);
+        throw std::runtime_error("cannot listen on port " + std::to_string(port));
+    }
+    bound_port = ntohs(addr.sin_port);
+    acceptor = std::thread(&FakeBroker::accept_loop, this);
+    delayer = std::thread(&FakeBroker::delay_loop, this);
+}
+
+FakeBroker::~FakeBroker()
+{
+    stopping = true;
+    ::shutdown(listener, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (client >= 0)
+            ::shutdown(client, SHUT_RDWR);
+    }
+    acceptor.join();
+    {
+        std::lock_guard<std::mutex> guard(delay_lock);
+        delayed_ready.notify_all();
+    }
+    delayer.join();
+    ::close(listener);
+}
+
+std::string FakeBroker::address() const
+{
+    return "tcp://127.0.0.1:" + std::to_string(bound_port);
+}
+
+void FakeBroker::retain(const MqttPublish &publish)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = std::find_if(retained.begin(), retained.end(),
+                           [&publish](const MqttPublish &r) { return r.topic == publish.topic; });
+    if (publish.payload.empty()) {
+        if (it != retained.end())
+            retained.erase(it);
+    } else if (it != retained.end()) {
+        *it = publish;
+    } else {
+        retained.push_back(publish);
+        retained.back().retained = true;
+    }
+}
+
+void FakeBroker::set_delay(double seconds)
+{
+    std::lock_guard<std::mutex> guard(delay_lock);
+    delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+void FakeBroker::reply(std::string data)
+{
+    {
+        std::lock_guard<std::mutex> guard(delay_lock);
+        // once anything waits, later replies queue behind it
+        if (delay.count() > 0 || !delayed.empty()) {
+            delayed.emplace_back(std::chrono::steady_clock::now() + delay, std::move(data));
+            delayed_ready.notify_all();
+            return;
+        }
+    }
+    send(data);
+}
+
+void FakeBroker::delay_loop()
+{
+    std::unique_lock<std::mutex> guard(delay_lock);
+    while (!stopping) {
+        if (delayed.empty()) {
+            delayed_ready.wait(guard);
+            continue;
+        }
+        if (delayed_ready.wait_until(guard, delayed.front().first) == std::cv_status::no_timeout)
+            continue;
+        std::string data = std::move(delayed.front().second);
+        delayed.pop_front();
+        guard.unlock();
+        send(data);
+        guard.lock();
+    }
+}
+
+bool FakeBroker::wait_subscribed(double timeout)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    return subscribed.wait_for(guard, std::chrono::duration<double>(timeout), [this] { return !filters.empty(); });
+}
+
+bool FakeBroker::matches(const std::string &filter, const std::string &topic)
+{
+    std::size_t f = 0, t = 0;
+    for (;;) {
+        if (filter.compare(f, std::string::npos, "#") == 0)
+            return true;
+        const std::size_t f_end = std::min(filter.find('/', f), filter.size());
+        const std::size_t t_end = std::min(topic.find('/', t), topic.size());
+        if (filter.compare(f, f_end - f, "+") != 0 && filter.compare(f, f_end - f, topic, t, t_end - t) != 0)
+            return false;
+        if (f_end == filter.size() || t_end == topic.size()) {
+            // "a/#" also matches "a" itself
+            return (f_end == filter.size() && t_end == topic.size())
+                || (t_end == topic.size() && filter.compare(f_end, std::string::npos, "/#") == 0);
+        }
+        f = f_end + 1;
+        t = t_end + 1;
+    }
+}
+
+bool FakeBroker::subscribed_to(const std::string &topic) const
+{
+    for (const std::string &filter : filters) {
+        if (matches(filter, topic))
+            return true;
+    }
+    return false;
+}
+
+FakeBroker::Stream FakeBroker::stream(const std::vector<MqttPublish> &messages, double rate, double seconds)
+{
+    std::vector<std::string> packets;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (const MqttPublish &publish : messages) {
+            if (subscribed_to(publish.topic))
+                packets.push_back(encode_publish(publish, version));
+        }
+    }
+    Stream result;
+    if (packets.empty())
+        return result;
+
+    const std::size_t total = static_cast<std::size_t>(rate * seconds);
+    const auto start = std::chrono::steady_clock::now();
+    std::string chunk;
+    std::size_t next = 0;
+    while (result.sent < total) {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const std::size_t due = std::min(total, static_cast<std::size_t>(rate * elapsed) + 1);
+        if (due <= result.sent) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        chunk.clear();
+        for (; result.sent < due && chunk.size() < WRITE_CHUNK; ++result.sent) {
+            chunk += packets[next];
+            if (++next == packets.size())
+                next = 0;
+        }
+        if (!send(chunk))
+            break;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void FakeBroker::accept_loop()
+{
+    while (!stopping) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            client = fd;
+            version = 4;
+        }
+        serve(fd);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            client = -1;
+            filters.clear();
+        }
+        // a stream() still writing must not hit a reused descriptor
+        std::lock_guard<std::mutex> writing(write_lock);
+        ::close(fd);
+    }
+}
+
+void FakeBroker::serve(int fd)
+{
+    MqttStreamParser parser;
+    MqttPacket packet;
+    std::vector<char> buffer(WRITE_CHUNK);
+    for (;;) {
+        const ssize_t n = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (n <= 0 || stopping)
+            return;
+        parser.feed(buffer.data(), static_cast<std::size_t>(n));
+        while (parser.next(packet))
+            handle(fd, packet);
+        if (parser.broken())
+            return;
+    }
+}
+
+void FakeBroker::handle(int fd, const MqttPacket &packet)
+{
+    switch (packet.type) {
+    case MqttPacketType::Connect: {
+        const int announced = parse_connect_version(packet);
+        if (!announced) {
+            ::shutdown(fd, SHUT_RDWR);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            version = announced;
+        }
+        reply(connack(announced));
+        return;
+    }
+    case MqttPacketType::Subscribe:
+    case MqttPacketType::Unsubscribe: {
+        std::uint16_t packet_id;
+        std::vector<std::string> requested;
+        if (!parse_subscribe(packet, version, packet_id, requested)) {
+            ::shutdown(fd, SHUT_RDWR);
+            return;
+        }
+        std::string body = packet_id_body(packet_id);
+        if (version >= 5)
+            body += '\0';
+        if (packet.type == MqttPacketType::Unsubscribe) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (const std::string &filter : requested)
+                    filters.erase(std::remove(filters.begin(), filters.end(), filter), filters.end());
+            }
+            if (version >= 5)
+                body.append(requested.size(), '\0');
+            reply(encode_packet(MqttPacketType::Unsuback, 0, body));
+            return;
+        }
+        // QoS 0 granted for every valid filter
+        std::vector<std::string> granted;
+        for (const std::string &filter : requested) {
+            const bool valid = valid_filter(filter);
+            body += static_cast<char>(valid ? 0 : 0x80);
+            if (valid)
+                granted.push_back(filter);
+        }
+        reply(encode_packet(MqttPacketType::Suback, 0, body));
+
+        std::string burst;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (const MqttPublish &publish : retained) {
+                if (std::any_of(granted.begin(), granted.end(),
+                                [&publish](const std::string &f) { return matches(f, publish.topic); }))
+                    burst += encode_publish(publish, version);
+            }
+            filters.insert(filters.end(), granted.begin(), granted.end());
+        }
+        reply(std::move(burst));
+        subscribed.notify_all();
+        return;
+    }
+    case MqttPacketType::Publish: {
+        MqttPublish publish;
+        if (!parse_publish(packet, version, publish))
+            return;
+        if (publish.retained)
+            retain(publish);
+        if (publish.qos == 1)
+            reply(encode_packet(MqttPacketType::Puback, 0, packet_id_body(publish.packet_id)));
+        return;
+    }
+    case MqttPacketType::Pingreq:
+        reply(encode_packet(MqttPacketType::Pingresp, 0, std::string()));
+        return;
+    case MqttPacketType::Disconnect:
+        ::shutdown(fd, SHUT_RDWR);
+        return;
+    default:
+        return;
+    }
+}
+
+bool FakeBroker::send(const std::string &data)
+{
+    std::lock_guard<std::mutex> writing(write_lock);
+    int fd;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        fd = client;
+    }
+    if (fd < 0)
+        return false;
+    for (std::size_t at = 0; at < data.size();) {
+        const ssize_t n = ::send(fd, data.data() + at, data.size() - at, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        at += static_cast<std::size_t>(n);
+    }
+    return true;
+}
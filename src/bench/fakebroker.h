@@ -0,0 +1,92 @@
+#ifndef FAKEBROKER_H
+#define FAKEBROKER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "mqttpacket.h"
+
+/**
+ * Just enough of an MQTT 3.1.1 and 5 broker to feed the explorer over real
+ * TCP on localhost, driven by the benchmark instead of by publishers.
+ *
+ * One client at a time: CONNECT, SUBSCRIBE, UNSUBSCRIBE, PINGREQ, QoS 0/1
+ * PUBLISH and DISCONNECT are answered, everything the client publishes with
+ * the retain flag is kept. A subscription first gets the matching retained
+ * messages, like a real broker; stream() then sends a message sequence at a
+ * fixed rate. Nothing is queued per client: when the client reads slower
+ * than the offered rate, the socket fills up and the sender falls behind,
+ * which stream() reports as the achieved rate.
+ *
+ * set_delay() holds every reply back for a while, in order, to stand in
+ * for the round trip to a remote broker. Filters that are not valid MQTT
+ * filters are refused in the SUBACK.
+ */
+class FakeBroker
+{
+public:
+    struct Stream
+    {
+        std::size_t sent = 0;
+        double seconds = 0;
+    };
+
+    // port 0 picks a free one
+    explicit FakeBroker(std::uint16_t port = 0);
+    ~FakeBroker();
+    FakeBroker(const FakeBroker &) = delete;
+    FakeBroker &operator=(const FakeBroker &) = delete;
+
+    std::uint16_t port() const { return bound_port; }
+    std::string address() const;
+
+    void retain(const MqttPublish &publish);
+    // replies to the client leave this many seconds after its request
+    void set_delay(double seconds);
+    bool wait_subscribed(double timeout);
+    // messages round robin at `rate` per second for `seconds`, to the matching subscriptions
+    Stream stream(const std::vector<MqttPublish> &messages, double rate, double seconds);
+    // MQTT wildcard filter match, "+" for one level and a trailing "#" for any
+    static bool matches(const std::string &filter, const std::string &topic);
+
+private:
+    void accept_loop();
+    void serve(int fd);
+    void handle(int fd, const MqttPacket &packet);
+    // a reply, held back by the delay
+    void reply(std::string data);
+    void delay_loop();
+    bool send(const std::string &data);
+    bool subscribed_to(const std::string &topic) const;
+
+    int listener = -1;
+    std::uint16_t bound_port = 0;
+    std::thread acceptor;
+    std::atomic<bool> stopping{false};
+
+    mutable std::mutex lock;
+    std::condition_variable subscribed;
+    // the accepted connection, -1 if none
+    int client = -1;
+    int version = 4;
+    std::vector<std::string> filters;
+    std::vector<MqttPublish> retained;
+    // serialises whole packets on the client socket
+    std::mutex write_lock;
+
+    std::thread delayer;
+    std::mutex delay_lock;
+    std::condition_variable delayed_ready;
+    std::chrono::steady_clock::duration delay{0};
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> delayed;
+};
+
+#endif // FAKEBROKER_H
@@ -0,0 +1,103 @@
+#include "topicsets.h"
+#include "topicspace.h"
+
+namespace {
+
+const char *const SHAPES[] = {"flat", "deep", "wide", "fleet", "sparkplug"};
+const int DEEP_LEVELS = 12;
+
+TopicSpace::Config space_config(TopicShape shape, std::size_t count)
+{
+    TopicSpace::Config config;
+    config.layout = shape == TopicShape::Sparkplug ? TopicSpace::Layout::Sparkplug : TopicSpace::Layout::Tree;
+    config.topics = count;
+    // the fanout caps the devices, widen the top level until `count` topics fit
+    std::size_t devices = 1;
+    for (std::size_t fanout : config.fanout)
+        devices *= fanout;
+    while (devices * config.metrics < count) {
+        config.fanout.front() *= 2;
+        devices *= 2;
+    }
+    return config;
+}
+
+} // namespace
+
+std::vector<std::string> make_topics(TopicShape shape, std::size_t count)
+{
+    if (shape == TopicShape::Fleet || shape == TopicShape::Sparkplug)
+        return TopicSpace(space_config(shape, count)).topics();
+    std::vector<std::string> topics;
+    topics.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        switch (shape) {
+        case TopicShape::Flat:
+            topics.push_back("sensor_" + std::to_string(i));
+            break;
+        case TopicShape::Deep: {
+            // base 4 digits of i, so neighbours share most of their path
+            std::string topic;
+            std::size_t rest = i;
+            for (int level = 0; level < DEEP_LEVELS; ++level, rest /= 4) {
+                if (level)
+                    topic += '/';
+                topic += 'l' + std::to_string(level) + '_' + std::to_string(rest % 4);
+            }
+            topics.push_back(std::move(topic));
+            break;
+        }
+        case TopicShape::Wide:
+            topics.push_back("devices/" + std::to_string(i) + "/state");
+            break;
+        default:
+            break;
+        }
+    }
+    return topics;
+}
+
+std::vector<mqtt::const_message_ptr> make_messages(const std::vector<std::string> &topics, std::size_t payload)
+{
+    const std::string body(payload, 'x');
+    std::vector<mqtt::const_message_ptr> msgs;
+    msgs.reserve(topics.size());
+    for (const std::string &topic : topics)
+        msgs.push_back(mqtt::message::create(topic, body.data(), body.size(), 0, false));
+    return msgs;
+}
+
+std::vector<mqtt::const_message_ptr> make_traffic(TopicShape shape, std::size_t count, std::size_t payload)
+{
+    if (shape != TopicShape::Fleet && shape != TopicShape::Sparkplug)
+        return make_messages(make_topics(shape, count), payload);
+    TopicSpace::Config config = space_config(shape, count);
+    config.payload = payload;
+    std::vector<mqtt::const_message_ptr> msgs;
+    msgs.reserve(count);
+    for (const MqttPublish &publish : TopicSpace(config).traffic(count))
+        msgs.push_back(mqtt::message::create(publish.topic, publish.payload.data(), publish.payload.size(), 0, false));
+    return msgs;
+}
+
+std::vector<std::string> traffic_topics(TopicShape shape, std::size_t count)
+{
+    std::vector<std::string> topics;
+    topics.reserve(count);
+    for (const auto &msg : make_traffic(shape, count, 0))
+        topics.push_back(msg->get_topic());
+    return topics;
+}
+
+TopicShape shape_arg(benchmark::State &state)
+{
+    const TopicShape shape = static_cast<TopicShape>(state.range(0));
+    state.SetLabel(SHAPES[state.range(0)]);
+    return shape;
+}
+
+void topic_sets(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"shape", "topics"});
+    b->ArgsProduct({{0, 1, 2, 3, 4}, {1000, 100000}});
+}
@@ -0,0 +1,36 @@
+#ifndef TOPICSETS_H
+#define TOPICSETS_H
+
+#include <benchmark/benchmark.h>
+#include <mqtt/message.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * Synthetic topic sets the benchmarks run on:
+ *  - Flat: every topic is a single level, e.g. "sensor_42";
+ *  - Deep: 12 levels with a fan-out of 4, e.g. "l0_1/l1_3/.../l11_0";
+ *  - Wide: one parent with every topic below it, e.g. "devices/42/state";
+ *  - Fleet and Sparkplug: TopicSpace namespaces with Zipf distributed,
+ *    bursty traffic, as real fleets publish.
+ * The first three are sent round robin, the same shape and count always
+ * give the same topics and traffic. Fleet and Sparkplug traffic only
+ * reaches the hotter part of the namespace: benchmarks of the tree as a
+ * whole, like insert and find, take make_topics(), those of the per
+ * message path make_traffic().
+ */
+enum class TopicShape { Flat, Deep, Wide, Fleet, Sparkplug };
+
+std::vector<std::string> make_topics(TopicShape shape, std::size_t count);
+std::vector<mqtt::const_message_ptr> make_messages(const std::vector<std::string> &topics, std::size_t payload);
+// `count` messages over a namespace of about `count` topics, the Zipf tail of it rarely or never
+std::vector<mqtt::const_message_ptr> make_traffic(TopicShape shape, std::size_t count, std::size_t payload);
+// the topic of every message of make_traffic()
+std::vector<std::string> traffic_topics(TopicShape shape, std::size_t count);
+
+// benchmarks taking the shape as range(0) and the topic count as range(1)
+TopicShape shape_arg(benchmark::State &state);
+void topic_sets(benchmark::internal::Benchmark *b);
+
+#endif // TOPICSETS_H
@@ -0,0 +1,159 @@
+#include "topicspace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char *const LEVELS[] = {"site", "area", "line", "cell", "unit", "module"};
+const char *const METRICS[] = {"temperature", "pressure", "torque", "speed", "current", "voltage", "state", "position"};
+
+std::string level_name(std::size_t level, std::size_t index)
+{
+    const std::string base = level < 6 ? LEVELS[level] : "level" + std::to_string(level);
+    return base + std::to_string(index);
+}
+
+std::string metric_name(std::size_t metric)
+{
+    return metric < 8 ? METRICS[metric] : METRICS[metric % 8] + std::to_string(metric / 8);
+}
+
+} // namespace
+
+TopicSpace::TopicSpace(const Config &config):
+    config(config),
+    random(config.seed)
+{
+    if (config.layout == Layout::Sparkplug)
+        build_sparkplug();
+    else
+        build_tree();
+    device_first.push_back(all.size());
+
+    const std::size_t n = devices();
+    std::bernoulli_distribution retain(config.retained_fraction);
+    for (std::size_t d = 0; d < n; ++d)
+        device_retained.push_back(retain(random));
+
+    double sum = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+        sum += 1 / std::pow(static_cast<double>(k + 1), config.zipf);
+        cdf.push_back(sum);
+    }
+    rank_device.resize(n);
+    for (std::size_t d = 0; d < n; ++d)
+        rank_device[d] = d;
+    std::shuffle(rank_device.begin(), rank_device.end(), random);
+    device_next.assign(n, 0);
+}
+
+void TopicSpace::add_device(std::vector<std::string> topics)
+{
+    device_first.push_back(all.size());
+    for (std::string &topic : topics)
+        all.push_back(std::move(topic));
+}
+
+void TopicSpace::build_tree()
+{
+    // a random part of the full namespace, so every level is only partly used
+    std::size_t capacity = 1;
+    for (std::size_t f : config.fanout)
+        capacity *= std::max<std::size_t>(f, 1);
+    const std::size_t wanted = std::min(capacity, (config.topics + config.metrics - 1) / std::max<std::size_t>(config.metrics, 1));
+    std::vector<std::size_t> chosen(capacity);
+    for (std::size_t i = 0; i < capacity; ++i)
+        chosen[i] = i;
+    std::shuffle(chosen.begin(), chosen.end(), random);
+    chosen.resize(wanted);
+    std::sort(chosen.begin(), chosen.end());
+
+    for (std::size_t device : chosen) {
+        // mixed radix digits, the deepest level the least significant
+        std::vector<std::string> levels(config.fanout.size());
+        for (std::size_t k = levels.size(); k-- > 0; device /= std::max<std::size_t>(config.fanout[k], 1))
+            levels[k] = level_name(k, device % std::max<std::size_t>(config.fanout[k], 1));
+        std::string path;
+        for (const std::string &level : levels)
+            path += level + '/';
+        std::vector<std::string> metrics;
+        for (std::size_t m = 0; m < config.metrics; ++m)
+            metrics.push_back(path + metric_name(m));
+        add_device(std::move(metrics));
+    }
+}
+
+void TopicSpace::build_sparkplug()
+{
+    for (std::size_t n = 0; all.size() < config.topics; ++n) {
+        const std::string group = "spBv1.0/group" + std::to_string(n % config.groups);
+        const std::string node = "edge" + std::to_string(n / config.groups);
+        // every device has its birth certificate first, then its data topic
+        add_device({group + "/NBIRTH/" + node, group + "/NDATA/" + node});
+        for (std::size_t d = 0; d < config.node_devices; ++d) {
+            const std::string device = "/" + node + "/device" + std::to_string(d);
+            add_device({group + "/DBIRTH" + device, group + "/DDATA" + device});
+        }
+    }
+}
+
+std::size_t TopicSpace::births() const
+{
+    return config.layout == Layout::Sparkplug ? 1 : 0;
+}
+
+std::vector<std::size_t> TopicSpace::sequence(std::size_t messages)
+{
+    std::vector<std::size_t> out;
+    out.reserve(messages);
+    std::uniform_real_distribution<double> uniform(0, cdf.empty() ? 0 : cdf.back());
+    while (out.size() < messages && !cdf.empty()) {
+        const std::size_t rank = std::min<std::size_t>(std::upper_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin(),
+                                                       cdf.size() - 1);
+        const std::size_t d = rank_device[rank];
+        const std::size_t first = device_first[d] + births();
+        const std::size_t data = device_first[d + 1] - first;
+        for (std::size_t i = 0; i < std::min(config.burst, data) && out.size() < messages; ++i) {
+            out.push_back(first + device_next[d]);
+            device_next[d] = (device_next[d] + 1) % data;
+        }
+    }
+    return out;
+}
+
+MqttPublish TopicSpace::publish(std::size_t topic)
+{
+    MqttPublish publish;
+    publish.topic = all[topic];
+    // numeric text, so the payload also feeds plots, padded to the configured size
+    std::uniform_real_distribution<double> value(0, 100);
+    publish.payload = std::to_string(value(random));
+    if (publish.payload.size() < config.payload)
+        publish.payload.resize(config.payload, ' ');
+    return publish;
+}
+
+std::vector<MqttPublish> TopicSpace::traffic(std::size_t messages)
+{
+    std::vector<MqttPublish> out;
+    out.reserve(messages);
+    for (std::size_t topic : sequence(messages))
+        out.push_back(publish(topic));
+    return out;
+}
+
+std::vector<MqttPublish> TopicSpace::retained()
+{
+    std::vector<MqttPublish> out;
+    for (std::size_t d = 0; d < devices(); ++d) {
+        if (!device_retained[d])
+            continue;
+        // the births of a Sparkplug device, all metrics of a tree device
+        const std::size_t end = births() ? device_first[d] + births() : device_first[d + 1];
+        for (std::size_t topic = device_first[d]; topic < end; ++topic) {
+            out.push_back(publish(topic));
+            out.back().retained = true;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,84 @@
+#ifndef TOPICSPACE_H
+#define TOPICSPACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "mqttpacket.h"
+
+/**
+ * Synthetic topic namespace and traffic of a device fleet.
+ *
+ * Topics are grouped by device, the unit that publishes: a Tree namespace
+ * has `fanout[k]` children per node on level k and the metrics of a device
+ * as leaves below the last level, e.g. "site2/line14/cell3/robot5/torque";
+ * a Sparkplug namespace has "spBv1.0/<group>/<type>/<node>[/<device>]"
+ * with NDATA/DDATA for traffic and NBIRTH/DBIRTH as the retained set.
+ *
+ * Devices publish with Zipf distributed rates: the device of rank k is
+ * picked with weight 1 / (k + 1)^zipf, and ranks are shuffled over the
+ * namespace so hot devices are not neighbours. A pick sends a burst of
+ * up to `burst` metrics of the device back to back. The retained set is
+ * whole devices, as a reconnecting fleet delivers it. Everything follows
+ * from the seed, so runs are repeatable.
+ */
+class TopicSpace
+{
+public:
+    enum class Layout { Tree, Sparkplug };
+
+    struct Config
+    {
+        Layout layout = Layout::Tree;
+        // devices are created until about this many topics exist
+        std::size_t topics = 10000;
+        // Tree: children per level down to the devices, their product caps the devices
+        std::vector<std::size_t> fanout{4, 16, 8, 8, 4};
+        // Tree: leaves per device
+        std::size_t metrics = 8;
+        // Sparkplug: groups and devices per edge node
+        std::size_t groups = 4;
+        std::size_t node_devices = 8;
+        double zipf = 1.1;
+        // most messages of a device sent per pick
+        std::size_t burst = 4;
+        // share of the devices with all their topics retained
+        double retained_fraction = 0.3;
+        std::size_t payload = 64;
+        std::uint64_t seed = 1;
+    };
+
+    explicit TopicSpace(const Config &config);
+
+    const std::vector<std::string> &topics() const { return all; }
+    std::size_t devices() const { return device_first.size() - 1; }
+
+    // topic index of every message, in order
+    std::vector<std::size_t> sequence(std::size_t messages);
+    std::vector<MqttPublish> traffic(std::size_t messages);
+    std::vector<MqttPublish> retained();
+
+private:
+    void build_tree();
+    void build_sparkplug();
+    void add_device(std::vector<std::string> topics);
+    // leading topics of every device that are only retained, never traffic
+    std::size_t births() const;
+    MqttPublish publish(std::size_t topic);
+
+    Config config;
+    std::mt19937_64 random;
+    std::vector<std::string> all;
+    // topics of device d are [device_first[d], device_first[d + 1]) of all,
+    // the last entry is all.size()
+    std::vector<std::size_t> device_first;
+    std::vector<bool> device_retained;
+    // cumulative Zipf weights by rank, and the device of every rank
+    std::vector<double> cdf;
+    std::vector<std::size_t> rank_device;
+    std::vector<std::size_t> device_next;
+};
+
+#endif // TOPICSPACE_H
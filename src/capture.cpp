@@ -0,0 +1,177 @@
+#include "capture.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[6] = {'M', 'Q', 'X', 'C', 'A', 'P'};
+const std::uint16_t VERSION = 1;
+const std::size_t FIXED = sizeof(double) + 1 + sizeof(std::uint16_t) + sizeof(std::uint32_t);
+const std::size_t BUFFER = 1 << 20;
+
+template <typename T>
+void put(std::string &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T get(const char *p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string &path):
+    file(std::fopen(path.c_str(), "wb"))
+{
+    if (!file)
+        throw std::runtime_error("cannot create capture " + path);
+    buffer.reserve(BUFFER);
+    buffer.append(MAGIC, sizeof(MAGIC));
+    put(buffer, VERSION);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    try {
+        flush();
+    } catch (const std::exception &exc) {
+        std::fprintf(stderr, "Error: %s\n", exc.what());
+    }
+    std::fclose(file);
+}
+
+void CaptureWriter::encode(std::string &out, double time, const char *topic, std::size_t topic_size,
+                           const char *payload, std::size_t size, int qos, bool retained)
+{
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(FIXED + topic_size + size));
+    put(out, time);
+    put<std::uint8_t>(out, static_cast<std::uint8_t>((qos & 3) | (retained ? 4 : 0)));
+    put<std::uint16_t>(out, static_cast<std::uint16_t>(topic_size));
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(size));
+    out.append(topic, topic_size);
+    out.append(payload, size);
+}
+
+void CaptureWriter::write(double time, const std::string &topic, const char *payload, std::size_t size,
+                          int qos, bool retained)
+{
+    encode(buffer, time, topic.data(), topic.size(), payload, size, qos, retained);
+    if (buffer.size() >= BUFFER)
+        flush();
+}
+
+void CaptureWriter::write(const CaptureRecord &record)
+{
+    write(record.time, record.topic, record.payload.data(), record.payload.size(), record.qos, record.retained);
+}
+
+void CaptureWriter::write_raw(const std::string &records)
+{
+    if (buffer.size() + records.size() < BUFFER) {
+        buffer += records;
+        return;
+    }
+    flush();
+    if (std::fwrite(records.data(), 1, records.size(), file) != records.size())
+        throw std::runtime_error("cannot write capture");
+}
+
+void CaptureWriter::flush()
+{
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        throw std::runtime_error("cannot write capture");
+    buffer.clear();
+}
+
+CaptureReader::CaptureReader(const std::string &path):
+    file(std::fopen(path.c_str(), "rb"))
+{
+    if (!file)
+        throw std::runtime_error("cannot open capture " + path);
+    std::setvbuf(file, nullptr, _IOFBF, BUFFER);
+
+    char header[sizeof(MAGIC) + sizeof(VERSION)];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header)
+            || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0
+            || get<std::uint16_t>(header + sizeof(MAGIC)) != VERSION) {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a capture file");
+    }
+}
+
+CaptureReader::~CaptureReader()
+{
+    std::fclose(file);
+}
+
+bool CaptureReader::read_record(std::string &raw)
+{
+    char prefix[sizeof(std::uint32_t)];
+    if (std::fread(prefix, 1, sizeof(prefix), file) != sizeof(prefix))
+        return false;
+    const std::uint32_t size = get<std::uint32_t>(prefix);
+    if (size < FIXED)
+        throw std::runtime_error("corrupt capture record");
+
+    const std::size_t at = raw.size();
+    raw.resize(at + sizeof(prefix) + size);
+    std::memcpy(&raw[at], prefix, sizeof(prefix));
+    if (std::fread(&raw[at + sizeof(prefix)], 1, size, file) != size) {
+        // a capture cut short while recording, drop the partial record
+        raw.resize(at);
+        return false;
+    }
+    return true;
+}
+
+std::size_t CaptureReader::read_batch(std::string &raw, std::size_t max_records, std::size_t max_bytes)
+{
+    std::size_t n = 0;
+    while (n < max_records && raw.size() < max_bytes && read_record(raw))
+        ++n;
+    return n;
+}
+
+bool CaptureReader::next(CaptureRecord &record)
+{
+    std::string raw;
+    if (!read_record(raw))
+        return false;
+    const char *cursor = raw.data();
+    CaptureRecordView view;
+    parse(cursor, raw.data() + raw.size(), view);
+    record.time = view.time;
+    record.qos = view.qos;
+    record.retained = view.retained;
+    record.topic.assign(view.topic, view.topic_size);
+    record.payload.assign(view.payload, view.payload_size);
+    return true;
+}
+
+bool CaptureReader::parse(const char *&cursor, const char *end, CaptureRecordView &view)
+{
+    if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(std::uint32_t) + FIXED))
+        return false;
+    const std::uint32_t size = get<std::uint32_t>(cursor);
+    const char *p = cursor + sizeof(std::uint32_t);
+    view.time = get<double>(p);
+    p += sizeof(double);
+    const std::uint8_t flags = static_cast<std::uint8_t>(*p++);
+    view.qos = flags & 3;
+    view.retained = flags & 4;
+    view.topic_size = get<std::uint16_t>(p);
+    p += sizeof(std::uint16_t);
+    view.payload_size = get<std::uint32_t>(p);
+    p += sizeof(std::uint32_t);
+    if (FIXED + view.topic_size + view.payload_size != size || p + view.topic_size + view.payload_size > end)
+        throw std::runtime_error("corrupt capture record");
+    view.topic = p;
+    view.payload = p + view.topic_size;
+    cursor = p + view.topic_size + view.payload_size;
+    return true;
+}
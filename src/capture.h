@@ -0,0 +1,85 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/*
+ * Capture file: an 8 byte header "MQXCAP" + u16 version, followed by
+ * records of
+ *
+ *     u32 size of the rest | f64 time | u8 flags | u16 topic size |
+ *     u32 payload size | topic | payload
+ *
+ * in host (little endian) byte order. flags holds the QoS in bits 0-1 and
+ * the retain flag in bit 2. The size prefix lets readers skip or batch
+ * records without decoding them.
+ */
+
+struct CaptureRecord
+{
+    double time = 0;
+    int qos = 0;
+    bool retained = false;
+    std::string topic;
+    std::string payload;
+};
+
+// a record decoded in place from a raw batch, valid as long as the batch
+struct CaptureRecordView
+{
+    double time;
+    int qos;
+    bool retained;
+    const char *topic;
+    std::size_t topic_size;
+    const char *payload;
+    std::size_t payload_size;
+};
+
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(const std::string &path);
+    ~CaptureWriter();
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    void write(double time, const std::string &topic, const char *payload, std::size_t size,
+               int qos, bool retained);
+    void write(const CaptureRecord &record);
+    // appends records that were already encoded with encode()
+    void write_raw(const std::string &records);
+    void flush();
+
+    static void encode(std::string &out, double time, const char *topic, std::size_t topic_size,
+                       const char *payload, std::size_t size, int qos, bool retained);
+
+private:
+    std::FILE *file;
+    std::string buffer;
+};
+
+class CaptureReader
+{
+public:
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    bool next(CaptureRecord &record);
+    // appends whole raw records to `raw` until max_records or max_bytes is reached
+    std::size_t read_batch(std::string &raw, std::size_t max_records, std::size_t max_bytes);
+
+    // decodes the record at cursor and advances it, false at the end of the buffer
+    static bool parse(const char *&cursor, const char *end, CaptureRecordView &view);
+
+private:
+    bool read_record(std::string &raw);
+
+    std::FILE *file;
+};
+
+#endif // CAPTURE_H
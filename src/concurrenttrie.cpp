@@ -0,0 +1,198 @@
+#include "concurrenttrie.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+std::size_t level_hash(const char *name, std::size_t len)
+{
+    return std::hash<std::string_view>()(std::string_view(name, len));
+}
+
+} // namespace
+
+ConcurrentTopicTrie::Table::Table(std::size_t capacity):
+    slots(new std::atomic<Node *>[capacity]),
+    mask(capacity - 1)
+{
+    for (std::size_t i = 0; i < capacity; ++i)
+        slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ConcurrentTopicTrie::ReadGuard::ReadGuard(const ConcurrentTopicTrie &trie)
+{
+    const std::uint64_t e = trie.epoch.load();
+    std::size_t i = std::hash<std::thread::id>()(std::this_thread::get_id()) % READERS;
+    for (;; i = (i + 1) % READERS) {
+        std::uint64_t free_slot = 0;
+        if (trie.readers[i].epoch.compare_exchange_strong(free_slot, e))
+            break;
+    }
+    slot = &trie.readers[i].epoch;
+}
+
+ConcurrentTopicTrie::ReadGuard::~ReadGuard()
+{
+    slot->store(0, std::memory_order_release);
+}
+
+ConcurrentTopicTrie::ConcurrentTopicTrie(std::size_t shards):
+    readers(new ReaderSlot[READERS])
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(shards, 1); ++i)
+        this->shards.push_back(std::make_unique<Shard>());
+}
+
+ConcurrentTopicTrie::~ConcurrentTopicTrie()
+{
+    for (auto &shard : shards) {
+        delete shard->root.children.load();
+        for (Node &node : shard->nodes)
+            delete node.children.load();
+    }
+    for (auto &r : retired)
+        delete r.second;
+}
+
+ConcurrentTopicTrie::Shard &ConcurrentTopicTrie::shard_of(const std::string &topic, std::size_t &level_end) const
+{
+    level_end = std::min(topic.find('/'), topic.size());
+    return *shards[level_hash(topic.data(), level_end) % shards.size()];
+}
+
+ConcurrentTopicTrie::Node *ConcurrentTopicTrie::child(const Node *parent, const char *name, std::size_t len, std::size_t hash)
+{
+    // seq_cst pairs with the reader announcement, see retire()
+    const Table *table = parent->children.load();
+    if (!table)
+        return nullptr;
+    for (std::size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        Node *c = table->slots[i].load(std::memory_order_acquire);
+        if (!c)
+            return nullptr;
+        if (c->hash == hash && c->name.size() == len && std::memcmp(c->name.data(), name, len) == 0)
+            return c;
+    }
+}
+
+ConcurrentTopicTrie::Node *ConcurrentTopicTrie::find_node(const std::string &topic) const
+{
+    std::size_t end;
+    const Node *node = &shard_of(topic, end).root;
+    std::size_t begin = 0;
+    for (;;) {
+        node = child(node, topic.data() + begin, end - begin, level_hash(topic.data() + begin, end - begin));
+        if (!node || end == topic.size())
+            return const_cast<Node *>(node);
+        begin = end + 1;
+        end = std::min(topic.find('/', begin), topic.size());
+    }
+}
+
+ConcurrentTopicTrie::Node *ConcurrentTopicTrie::insert_node(const std::string &topic)
+{
+    std::size_t end;
+    Shard &shard = shard_of(topic, end);
+    // tables of this shard are only replaced under its lock, so no guard is needed
+    std::lock_guard<std::mutex> guard(shard.lock);
+    Node *node = &shard.root;
+    std::size_t begin = 0;
+    for (;;) {
+        const std::size_t hash = level_hash(topic.data() + begin, end - begin);
+        Node *next = child(node, topic.data() + begin, end - begin, hash);
+        if (!next) {
+            shard.nodes.emplace_back();
+            next = &shard.nodes.back();
+            next->name.assign(topic, begin, end - begin);
+            next->hash = hash;
+            add_child(node, next);
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+        node = next;
+        if (end == topic.size())
+            return node;
+        begin = end + 1;
+        end = std::min(topic.find('/', begin), topic.size());
+    }
+}
+
+void ConcurrentTopicTrie::add_child(Node *parent, Node *node)
+{
+    Table *table = parent->children.load(std::memory_order_relaxed);
+    if (!table || (table->used + 1) * 2 > table->mask + 1) {
+        Table *grown = new Table(table ? 2 * (table->mask + 1) : 8);
+        if (table) {
+            for (std::size_t i = 0; i <= table->mask; ++i) {
+                Node *c = table->slots[i].load(std::memory_order_relaxed);
+                if (!c)
+                    continue;
+                std::size_t j = c->hash & grown->mask;
+                while (grown->slots[j].load(std::memory_order_relaxed))
+                    j = (j + 1) & grown->mask;
+                grown->slots[j].store(c, std::memory_order_relaxed);
+            }
+            grown->used = table->used;
+        }
+        parent->children.store(grown);
+        if (table)
+            retire(table);
+        table = grown;
+    }
+
+    std::size_t i = node->hash & table->mask;
+    while (table->slots[i].load(std::memory_order_relaxed))
+        i = (i + 1) & table->mask;
+    table->slots[i].store(node, std::memory_order_release);
+    ++table->used;
+}
+
+void ConcurrentTopicTrie::retire(Table *table)
+{
+    // readers announced in this epoch or before may still hold the table,
+    // later ones can only have loaded its replacement
+    const std::uint64_t unlinked = epoch.fetch_add(1);
+    std::lock_guard<std::mutex> guard(retire_lock);
+    retired.emplace_back(unlinked, table);
+
+    std::uint64_t oldest = UINT64_MAX;
+    for (std::size_t i = 0; i < READERS; ++i) {
+        const std::uint64_t e = readers[i].epoch.load();
+        if (e)
+            oldest = std::min(oldest, e);
+    }
+    auto keep = std::partition(retired.begin(), retired.end(),
+                               [oldest](const std::pair<std::uint64_t, Table *> &r) { return r.first >= oldest; });
+    for (auto it = keep; it != retired.end(); ++it)
+        delete it->second;
+    retired.erase(keep, retired.end());
+}
+
+ConcurrentTopicTrie::Node *ConcurrentTopicTrie::intern(const std::string &topic)
+{
+    Node *node;
+    {
+        ReadGuard guard(*this);
+        node = find_node(topic);
+    }
+    return node ? node : insert_node(topic);
+}
+
+void ConcurrentTopicTrie::update(const mqtt::const_message_ptr &msg)
+{
+    update(intern(msg->get_topic()), msg);
+}
+
+void ConcurrentTopicTrie::update(Node *node, const mqtt::const_message_ptr &msg)
+{
+    std::atomic_store(&node->value, msg);
+}
+
+mqtt::const_message_ptr ConcurrentTopicTrie::find(const std::string &topic) const
+{
+    ReadGuard guard(*this);
+    const Node *node = find_node(topic);
+    return node ? std::atomic_load(&node->value) : nullptr;
+}
@@ -0,0 +1,107 @@
+#ifndef CONCURRENTTRIE_H
+#define CONCURRENTTRIE_H
+
+#include <mqtt/message.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Latest message per topic, written and read from any number of threads.
+ *
+ * The trie is sharded by the first topic level. Readers never lock: child
+ * tables are open-addressing arrays of atomic pointers, and a table that
+ * outgrows itself is replaced as a whole and freed by epoch-based
+ * reclamation once no reader can still be walking it. Writers only take
+ * their shard's lock to add a missing level; updating an existing topic is
+ * a single atomic store. Topics are never removed.
+ */
+class ConcurrentTopicTrie
+{
+    struct Table;
+
+public:
+    // callers only hold on to pointers, see intern()
+    struct Node
+    {
+        std::string name;
+        std::size_t hash = 0;
+        std::atomic<Table *> children{nullptr};
+        // only accessed through std::atomic_load / std::atomic_store
+        mqtt::const_message_ptr value;
+    };
+
+    explicit ConcurrentTopicTrie(std::size_t shards = 64);
+    ~ConcurrentTopicTrie();
+    ConcurrentTopicTrie(const ConcurrentTopicTrie &) = delete;
+    ConcurrentTopicTrie &operator=(const ConcurrentTopicTrie &) = delete;
+
+    void update(const mqtt::const_message_ptr &msg);
+    // the node of a topic, created if needed; valid as long as the trie
+    Node *intern(const std::string &topic);
+    // skips the lookup for callers that kept the node, e.g. per topic alias
+    void update(Node *node, const mqtt::const_message_ptr &msg);
+    // null for unknown topics and for levels nothing was published to
+    mqtt::const_message_ptr find(const std::string &topic) const;
+    // topic levels
+    std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    struct Table
+    {
+        explicit Table(std::size_t capacity);
+
+        std::unique_ptr<std::atomic<Node *>[]> slots;
+        std::size_t mask;
+        // only touched under the shard lock
+        std::size_t used = 0;
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        Node root;
+        std::deque<Node> nodes;
+    };
+
+    // announces a reader, tables it can reach are not freed before it leaves
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const ConcurrentTopicTrie &trie);
+        ~ReadGuard();
+
+    private:
+        std::atomic<std::uint64_t> *slot;
+    };
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<std::uint64_t> epoch{0};
+    };
+    static constexpr std::size_t READERS = 128;
+
+    Shard &shard_of(const std::string &topic, std::size_t &level_end) const;
+    static Node *child(const Node *parent, const char *name, std::size_t len, std::size_t hash);
+    Node *find_node(const std::string &topic) const;
+    Node *insert_node(const std::string &topic);
+    void add_child(Node *parent, Node *node);
+    void retire(Table *table);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<std::size_t> count{0};
+
+    std::unique_ptr<ReaderSlot[]> readers;
+    std::atomic<std::uint64_t> epoch{1};
+    std::mutex retire_lock;
+    // replaced tables and the epoch they were unlinked in
+    std::vector<std::pair<std::uint64_t, Table *>> retired;
+};
+
+#endif // CONCURRENTTRIE_H
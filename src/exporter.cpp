@@ -0,0 +1,326 @@
+#include "exporter.h"
+#include "capture.h"
+#include "taskpool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const std::size_t BATCH_RECORDS = 4096;
+const std::size_t BATCH_BYTES = 8 << 20;
+const std::size_t WRITE_BUFFER = 4 << 20;
+const char COLUMNAR_MAGIC[8] = {'M', 'Q', 'X', 'C', 'O', 'L', '1', '\0'};
+
+struct Formatted
+{
+    std::string text;
+    std::size_t records = 0;
+};
+
+bool printable_utf8(const char *data, std::size_t size)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size;) {
+        const unsigned char c = p[i];
+        if (c < 0x80) {
+            if (c < 0x20 && c != '\t' && c != '\n' && c != '\r')
+                return false;
+            ++i;
+            continue;
+        }
+        const std::size_t n = c >= 0xf5 ? 0 : c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc2 ? 2 : 0;
+        if (n == 0 || i + n > size)
+            return false;
+        for (std::size_t k = 1; k < n; ++k) {
+            if ((p[i + k] & 0xc0) != 0x80)
+                return false;
+        }
+        i += n;
+    }
+    return true;
+}
+
+void base64(std::string &out, const char *data, std::size_t size)
+{
+    static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    std::size_t i = 0;
+    for (; i + 2 < size; i += 3) {
+        const std::uint32_t v = (p[i] << 16) | (p[i + 1] << 8) | p[i + 2];
+        out += TABLE[v >> 18];
+        out += TABLE[(v >> 12) & 63];
+        out += TABLE[(v >> 6) & 63];
+        out += TABLE[v & 63];
+    }
+    if (i < size) {
+        const std::uint32_t v = (p[i] << 16) | (i + 1 < size ? p[i + 1] << 8 : 0);
+        out += TABLE[v >> 18];
+        out += TABLE[(v >> 12) & 63];
+        out += i + 1 < size ? TABLE[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+}
+
+void csv_field(std::string &out, const char *data, std::size_t size)
+{
+    out += '"';
+    for (std::size_t i = 0; i < size; ++i) {
+        if (data[i] == '"')
+            out += '"';
+        out += data[i];
+    }
+    out += '"';
+}
+
+void json_string(std::string &out, const char *data, std::size_t size)
+{
+    out += '"';
+    for (std::size_t i = 0; i < size; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+void append_time(std::string &out, double time)
+{
+    char text[32];
+    const int n = std::snprintf(text, sizeof(text), "%.6f", time);
+    out.append(text, static_cast<std::size_t>(n));
+}
+
+template <typename T>
+void append_raw(std::string &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+Formatted format_text(const std::string &raw, ExportFormat format)
+{
+    Formatted result;
+    result.text.reserve(raw.size() * 3 / 2);
+    std::string &out = result.text;
+    const char *cursor = raw.data(), *end = raw.data() + raw.size();
+    CaptureRecordView r;
+    while (CaptureReader::parse(cursor, end, r)) {
+        const bool text = printable_utf8(r.payload, r.payload_size);
+        if (format == ExportFormat::Csv) {
+            append_time(out, r.time);
+            out += ',';
+            csv_field(out, r.topic, r.topic_size);
+            out += r.qos == 2 ? ",2," : r.qos == 1 ? ",1," : ",0,";
+            out += r.retained ? "1," : "0,";
+            if (text) {
+                out += "utf8,";
+                csv_field(out, r.payload, r.payload_size);
+            } else {
+                out += "base64,";
+                base64(out, r.payload, r.payload_size);
+            }
+        } else {
+            out += "{\"time\":";
+            append_time(out, r.time);
+            out += ",\"topic\":";
+            json_string(out, r.topic, r.topic_size);
+            out += ",\"qos\":";
+            out += static_cast<char>('0' + r.qos);
+            out += r.retained ? ",\"retained\":true" : ",\"retained\":false";
+            if (text) {
+                out += ",\"payload\":";
+                json_string(out, r.payload, r.payload_size);
+            } else {
+                out += ",\"payload_base64\":\"";
+                base64(out, r.payload, r.payload_size);
+                out += '"';
+            }
+            out += '}';
+        }
+        out += '\n';
+        ++result.records;
+    }
+    return result;
+}
+
+// one row group: row count, then the time, qos, retained, topic and payload columns
+Formatted format_columnar(const std::string &raw)
+{
+    std::vector<CaptureRecordView> rows;
+    const char *cursor = raw.data(), *end = raw.data() + raw.size();
+    CaptureRecordView r;
+    while (CaptureReader::parse(cursor, end, r))
+        rows.push_back(r);
+
+    Formatted result;
+    result.records = rows.size();
+    std::string &out = result.text;
+    out.reserve(raw.size() + rows.size() * 16);
+    append_raw<std::uint32_t>(out, static_cast<std::uint32_t>(rows.size()));
+    for (const CaptureRecordView &v : rows)
+        append_raw(out, v.time);
+    for (const CaptureRecordView &v : rows)
+        out += static_cast<char>(v.qos);
+    for (const CaptureRecordView &v : rows)
+        out += static_cast<char>(v.retained);
+
+    std::uint32_t topic_offset = 0;
+    append_raw(out, topic_offset);
+    for (const CaptureRecordView &v : rows)
+        append_raw(out, topic_offset += static_cast<std::uint32_t>(v.topic_size));
+    for (const CaptureRecordView &v : rows)
+        out.append(v.topic, v.topic_size);
+
+    std::uint64_t payload_offset = 0;
+    append_raw(out, payload_offset);
+    for (const CaptureRecordView &v : rows)
+        append_raw(out, payload_offset += v.payload_size);
+    for (const CaptureRecordView &v : rows)
+        out.append(v.payload, v.payload_size);
+    return result;
+}
+
+class Output
+{
+public:
+    explicit Output(const std::string &path):
+        file(std::fopen(path.c_str(), "wb"))
+    {
+        if (!file)
+            throw std::runtime_error("cannot create " + path);
+        std::setvbuf(file, nullptr, _IOFBF, WRITE_BUFFER);
+    }
+    ~Output() { if (file) std::fclose(file); }
+
+    void write(const char *data, std::size_t size)
+    {
+        if (std::fwrite(data, 1, size, file) != size)
+            throw std::runtime_error("cannot write export");
+        written += size;
+    }
+
+    void close()
+    {
+        const int failed = std::fclose(file);
+        file = nullptr;
+        if (failed)
+            throw std::runtime_error("cannot write export");
+    }
+
+    std::uint64_t written = 0;
+
+private:
+    std::FILE *file;
+};
+
+} // namespace
+
+ExportFormat export_format_for(const std::string &path)
+{
+    auto ends_with = [&path](const char *suffix) {
+        const std::size_t n = std::strlen(suffix);
+        return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+    };
+    if (ends_with(".csv"))
+        return ExportFormat::Csv;
+    if (ends_with(".ndjson") || ends_with(".jsonl"))
+        return ExportFormat::Ndjson;
+    return ExportFormat::Columnar;
+}
+
+ExportStats export_capture(const std::string &capture, const std::string &output, ExportFormat format,
+                           unsigned threads, const std::function<void(const ExportStats &)> &progress,
+                           const std::atomic<bool> *cancel)
+{
+    TaskPool &pool = TaskPool::shared();
+    if (threads == 0)
+        threads = pool.size();
+
+    CaptureReader reader(capture);
+    Output out(output);
+
+    ExportStats stats;
+    std::vector<std::uint64_t> row_groups;
+    if (format == ExportFormat::Csv) {
+        static const char HEADER[] = "time,topic,qos,retained,encoding,payload\n";
+        out.write(HEADER, sizeof(HEADER) - 1);
+    } else if (format == ExportFormat::Columnar) {
+        out.write(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    }
+
+    // formatted in order of submission; the window bounds the batches held
+    std::deque<std::future<Formatted>> window;
+    std::exception_ptr error;
+    bool more = true;
+    while (more || !window.empty()) {
+        if (more && cancel && *cancel) {
+            error = std::make_exception_ptr(std::runtime_error("export cancelled"));
+            more = false;
+        }
+        while (more && !error && window.size() < 2 * threads) {
+            auto raw = std::make_shared<std::string>();
+            try {
+                more = reader.read_batch(*raw, BATCH_RECORDS, BATCH_BYTES) > 0;
+            } catch (...) {
+                error = std::current_exception();
+                more = false;
+            }
+            if (more)
+                window.push_back(pool.submit(TaskPool::Priority::Bulk, [raw, format] {
+                    return format == ExportFormat::Columnar ? format_columnar(*raw) : format_text(*raw, format);
+                }));
+        }
+        if (window.empty())
+            break;
+        // after a failure keep waiting, the tasks still refer to this frame's state
+        try {
+            Formatted f = pool.wait(window.front());
+            window.pop_front();
+            if (error)
+                continue;
+            if (format == ExportFormat::Columnar)
+                row_groups.push_back(out.written);
+            out.write(f.text.data(), f.text.size());
+            stats.records += f.records;
+            stats.bytes = out.written;
+            if (progress)
+                progress(stats);
+        } catch (...) {
+            window.pop_front();
+            if (!error)
+                error = std::current_exception();
+            more = false;
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    if (format == ExportFormat::Columnar) {
+        for (std::uint64_t offset : row_groups)
+            out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        const std::uint32_t count = static_cast<std::uint32_t>(row_groups.size());
+        out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        out.write(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    }
+    out.close();
+    stats.bytes = out.written;
+    return stats;
+}
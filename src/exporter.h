@@ -0,0 +1,42 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+enum class ExportFormat { Csv, Ndjson, Columnar };
+
+// picks the format from the file extension: .csv, .ndjson/.jsonl, anything else columnar
+ExportFormat export_format_for(const std::string &path);
+
+struct ExportStats
+{
+    std::uint64_t records = 0;
+    std::uint64_t bytes = 0;
+};
+
+/**
+ * Converts a capture file to CSV, NDJSON or the columnar format.
+ *
+ * The calling thread cuts the capture into raw batches, Bulk tasks of the
+ * shared TaskPool decode and format them concurrently and the calling
+ * thread writes the results in order through a large stdio buffer. At
+ * most 2 * threads batches are in flight (0: the pool size), so memory
+ * stays bounded for any capture size.
+ *
+ * Columnar files are Parquet-like: "MQXCOL1" header, one row group per
+ * batch with every column stored contiguously, and a footer listing the
+ * row group offsets followed by their count and the magic again.
+ *
+ * Payloads that are not printable UTF-8 are written base64 encoded.
+ * Throws std::runtime_error on I/O errors or a corrupt capture, and once
+ * *cancel is set, after the batches in flight are done.
+ */
+ExportStats export_capture(const std::string &capture, const std::string &output, ExportFormat format,
+                           unsigned threads = 0,
+                           const std::function<void(const ExportStats &)> &progress = {},
+                           const std::atomic<bool> *cancel = nullptr);
+
+#endif // EXPORTER_H
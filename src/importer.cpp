@@ -0,0 +1,675 @@
+#include "importer.h"
+#include "capture.h"
+#include "mqttpacket.h"
+#include "taskpool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const std::size_t CHUNK = 16 << 20;
+// out-of-order TCP data kept per direction before the stream is given up
+const std::size_t MAX_PENDING = 64 << 20;
+
+struct Parsed
+{
+    std::string records;
+    std::uint64_t count = 0;
+    std::uint64_t skipped = 0;
+};
+
+int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+bool decode_base64(const std::string &in, std::string &out)
+{
+    out.clear();
+    std::uint32_t bits = 0;
+    int count = 0;
+    for (char c : in) {
+        if (c == '=')
+            break;
+        const int v = base64_value(c);
+        if (v < 0)
+            return false;
+        bits = (bits << 6) | static_cast<std::uint32_t>(v);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out += static_cast<char>((bits >> count) & 0xff);
+        }
+    }
+    return true;
+}
+
+void append_utf8(std::string &out, std::uint32_t cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+// minimal reader for the flat JSON objects of an NDJSON line
+class JsonLine
+{
+public:
+    JsonLine(const char *p, const char *end): p(p), end(end) {}
+
+    bool parse(CaptureRecord &record)
+    {
+        bool has_topic = false;
+        std::string key, text;
+        skip();
+        if (!eat('{'))
+            return false;
+        skip();
+        if (eat('}'))
+            return false;
+        do {
+            skip();
+            if (!string(key))
+                return false;
+            skip();
+            if (!eat(':'))
+                return false;
+            skip();
+            if (p < end && *p == '"') {
+                if (!string(text))
+                    return false;
+                if (key == "topic") {
+                    record.topic = text;
+                    has_topic = true;
+                } else if (key == "payload") {
+                    record.payload = text;
+                } else if (key == "payload_base64" && !decode_base64(text, record.payload)) {
+                    return false;
+                }
+            } else if (literal("true")) {
+                if (key == "retained")
+                    record.retained = true;
+            } else if (literal("false") || literal("null")) {
+                if (key == "retained")
+                    record.retained = false;
+            } else {
+                char *stop = nullptr;
+                const double number = std::strtod(p, &stop);
+                if (stop == p || stop > end)
+                    return false;
+                p = stop;
+                if (key == "time")
+                    record.time = number;
+                else if (key == "qos")
+                    record.qos = std::clamp(static_cast<int>(number), 0, 2);
+            }
+            skip();
+        } while (eat(','));
+        return eat('}') && has_topic;
+    }
+
+private:
+    void skip()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+    }
+
+    bool eat(char c)
+    {
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char *word)
+    {
+        const std::size_t n = std::strlen(word);
+        if (static_cast<std::size_t>(end - p) >= n && std::memcmp(p, word, n) == 0) {
+            p += n;
+            return true;
+        }
+        return false;
+    }
+
+    bool hex4(std::uint32_t &value)
+    {
+        if (end - p < 4)
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *p++;
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string &out)
+    {
+        out.clear();
+        if (!eat('"'))
+            return false;
+        while (p < end) {
+            const char c = *p++;
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p == end)
+                return false;
+            switch (*p++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                std::uint32_t cp;
+                if (!hex4(cp))
+                    return false;
+                std::uint32_t low;
+                if (cp >= 0xd800 && cp < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    p += 2;
+                    if (!hex4(low))
+                        return false;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    const char *p;
+    const char *end;
+};
+
+bool parse_mosquitto_line(const char *p, const char *end, CaptureRecord &record)
+{
+    // optional "%U" timestamp in front of the topic
+    const char *q = p;
+    bool dot = false;
+    while (q < end && ((*q >= '0' && *q <= '9') || *q == '.')) {
+        dot = dot || *q == '.';
+        ++q;
+    }
+    if (dot && q > p && q < end && *q == ' ') {
+        record.time = std::strtod(p, nullptr);
+        p = q + 1;
+    }
+
+    const char *space = static_cast<const char *>(std::memchr(p, ' ', end - p));
+    const char *topic_end = space ? space : end;
+    if (topic_end == p)
+        return false;
+    record.topic.assign(p, topic_end);
+    record.payload.assign(space ? space + 1 : end, end);
+    return true;
+}
+
+Parsed parse_text(const std::string &text, ImportFormat format)
+{
+    Parsed parsed;
+    CaptureRecord record;
+    const char *p = text.data(), *end = p + text.size();
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *line_end = nl ? nl : end;
+        const char *stop = line_end > p && line_end[-1] == '\r' ? line_end - 1 : line_end;
+        if (stop > p) {
+            record = CaptureRecord();
+            const bool ok = format == ImportFormat::Ndjson
+                    ? JsonLine(p, stop).parse(record)
+                    : parse_mosquitto_line(p, stop, record);
+            if (ok) {
+                CaptureWriter::encode(parsed.records, record.time, record.topic.data(), record.topic.size(),
+                                      record.payload.data(), record.payload.size(), record.qos, record.retained);
+                ++parsed.count;
+            } else {
+                ++parsed.skipped;
+            }
+        }
+        p = line_end + 1;
+    }
+    return parsed;
+}
+
+ImportStats import_text(const std::string &input, CaptureWriter &writer, ImportFormat format, unsigned threads,
+                        const std::function<void(const ImportStats &)> &progress, const std::atomic<bool> *cancel)
+{
+    std::FILE *file = std::fopen(input.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open " + input);
+
+    TaskPool &pool = TaskPool::shared();
+    ImportStats stats;
+    std::exception_ptr error;
+    std::deque<std::future<Parsed>> window;
+    // chunks end at a newline, the rest of the last line moves to the next chunk
+    std::string carry;
+    bool more = true;
+    while (more || !window.empty()) {
+        if (more && cancel && *cancel) {
+            error = std::make_exception_ptr(std::runtime_error("import cancelled"));
+            more = false;
+        }
+        while (more && !error && window.size() < 2 * threads) {
+            auto text = std::make_shared<std::string>();
+            text->swap(carry);
+            const std::size_t at = text->size();
+            text->resize(at + CHUNK);
+            const std::size_t n = std::fread(&(*text)[at], 1, CHUNK, file);
+            text->resize(at + n);
+            more = n > 0;
+            if (text->empty())
+                break;
+            if (n > 0) {
+                const std::size_t last = text->rfind('\n');
+                if (last == std::string::npos) {
+                    // a line longer than the chunk, read on until it ends
+                    carry.swap(*text);
+                    continue;
+                }
+                if (last + 1 < text->size()) {
+                    carry.assign(*text, last + 1, std::string::npos);
+                    text->resize(last + 1);
+                }
+            }
+            window.push_back(pool.submit(TaskPool::Priority::Bulk, [text, format] { return parse_text(*text, format); }));
+        }
+        if (window.empty())
+            break;
+        try {
+            Parsed parsed = pool.wait(window.front());
+            window.pop_front();
+            if (error)
+                continue;
+            writer.write_raw(parsed.records);
+            stats.records += parsed.count;
+            stats.skipped += parsed.skipped;
+            if (progress)
+                progress(stats);
+        } catch (...) {
+            window.pop_front();
+            if (!error)
+                error = std::current_exception();
+            more = false;
+        }
+    }
+
+    std::fclose(file);
+    if (error)
+        std::rethrow_exception(error);
+    return stats;
+}
+
+std::uint16_t be16(const unsigned char *p) { return static_cast<std::uint16_t>((p[0] << 8) | p[1]); }
+std::uint32_t be32(const unsigned char *p)
+{
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+class PcapImporter
+{
+public:
+    PcapImporter(CaptureWriter &writer, std::uint16_t port): writer(writer), port(port) {}
+
+    void run(const std::string &input, const std::function<void(const ImportStats &)> &progress,
+             const std::atomic<bool> *cancel);
+    ImportStats stats;
+
+private:
+    struct Direction
+    {
+        bool started = false;
+        std::uint32_t base = 0;
+        std::uint32_t next = 0;
+        std::size_t pending_bytes = 0;
+        // out-of-order segments by offset relative to base
+        std::map<std::uint32_t, std::string> pending;
+        std::unordered_map<std::uint16_t, std::string> aliases;
+        MqttStreamParser parser;
+        // sequence number after the last byte, once a FIN announced it
+        bool fin = false;
+        std::uint32_t end = 0;
+
+        // nothing more will be delivered
+        bool finished() const { return fin && (!started || parser.broken() || base + next == end); }
+    };
+
+    struct Connection
+    {
+        int version = 4;
+        Direction sides[2];
+    };
+
+    void packet(double time, const unsigned char *p, std::size_t size, std::uint32_t link);
+    void ip(double time, const unsigned char *p, std::size_t size);
+    void tcp(double time, const std::string &src, const std::string &dst, const unsigned char *p, std::size_t size);
+    void segment(double time, Connection &connection, Direction &d, std::uint32_t seq, const char *data, std::size_t length);
+    void deliver(double time, Connection &connection, Direction &direction, const char *data, std::size_t size);
+
+    CaptureWriter &writer;
+    std::uint16_t port;
+    std::unordered_map<std::string, Connection> connections;
+    MqttPacket mqtt_packet;
+    MqttPublish publish;
+};
+
+void PcapImporter::run(const std::string &input, const std::function<void(const ImportStats &)> &progress,
+                       const std::atomic<bool> *cancel)
+{
+    std::FILE *file = std::fopen(input.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open " + input);
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> closer(file, std::fclose);
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    unsigned char header[24];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header))
+        throw std::runtime_error(input + " is not a pcap file");
+    std::uint32_t magic;
+    std::memcpy(&magic, header, 4);
+    bool swap = false, nanos = false;
+    switch (magic) {
+    case 0xa1b2c3d4: break;
+    case 0xd4c3b2a1: swap = true; break;
+    case 0xa1b23c4d: nanos = true; break;
+    case 0x4d3cb2a1: swap = nanos = true; break;
+    case 0x0a0d0d0a:
+        throw std::runtime_error("pcapng is not supported, convert with: editcap -F pcap");
+    default:
+        throw std::runtime_error(input + " is not a pcap file");
+    }
+    auto u32 = [swap](const unsigned char *p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return swap ? __builtin_bswap32(v) : v;
+    };
+    const std::uint32_t link = u32(header + 20);
+
+    std::vector<unsigned char> data;
+    unsigned char record[16];
+    std::uint64_t packets = 0;
+    while (std::fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        const std::uint32_t length = u32(record + 8);
+        if (length > (256u << 20))
+            throw std::runtime_error("corrupt pcap record");
+        data.resize(length);
+        if (std::fread(data.data(), 1, length, file) != length)
+            break;
+        const double time = u32(record) + u32(record + 4) / (nanos ? 1e9 : 1e6);
+        packet(time, data.data(), length, link);
+        if (++packets % 65536 == 0) {
+            if (cancel && *cancel)
+                throw std::runtime_error("import cancelled");
+            if (progress)
+                progress(stats);
+        }
+    }
+}
+
+void PcapImporter::packet(double time, const unsigned char *p, std::size_t size, std::uint32_t link)
+{
+    switch (link) {
+    case 1: { // Ethernet, possibly VLAN tagged
+        std::size_t at = 12;
+        while (size >= at + 2 && (be16(p + at) == 0x8100 || be16(p + at) == 0x88a8))
+            at += 4;
+        if (size < at + 2 || (be16(p + at) != 0x0800 && be16(p + at) != 0x86dd))
+            return;
+        ip(time, p + at + 2, size - at - 2);
+        return;
+    }
+    case 0: // BSD loopback
+        if (size > 4)
+            ip(time, p + 4, size - 4);
+        return;
+    case 12: case 101: case 228: case 229: // raw IP
+        ip(time, p, size);
+        return;
+    case 113: // Linux cooked
+        if (size > 16)
+            ip(time, p + 16, size - 16);
+        return;
+    case 276: // Linux cooked v2
+        if (size > 20)
+            ip(time, p + 20, size - 20);
+        return;
+    default:
+        throw std::runtime_error("unsupported pcap link type " + std::to_string(link));
+    }
+}
+
+void PcapImporter::ip(double time, const unsigned char *p, std::size_t size)
+{
+    if (size < 20)
+        return;
+    const int version = p[0] >> 4;
+    if (version == 4) {
+        const std::size_t header = (p[0] & 15) * 4u;
+        const std::size_t total = std::min<std::size_t>(be16(p + 2), size);
+        // fragments are rare on MQTT links, they are not reassembled
+        if (p[9] != 6 || header < 20 || total < header || (be16(p + 6) & 0x3fff) != 0)
+            return;
+        tcp(time, std::string(reinterpret_cast<const char *>(p + 12), 4),
+            std::string(reinterpret_cast<const char *>(p + 16), 4), p + header, total - header);
+    } else if (version == 6) {
+        if (size < 40 || p[6] != 6)
+            return;
+        const std::size_t total = std::min<std::size_t>(be16(p + 4), size - 40);
+        tcp(time, std::string(reinterpret_cast<const char *>(p + 8), 16),
+            std::string(reinterpret_cast<const char *>(p + 24), 16), p + 40, total);
+    }
+}
+
+void PcapImporter::tcp(double time, const std::string &src, const std::string &dst,
+                       const unsigned char *p, std::size_t size)
+{
+    if (size < 20)
+        return;
+    const std::uint16_t sport = be16(p), dport = be16(p + 2);
+    if (sport != port && dport != port)
+        return;
+    const std::size_t header = (p[12] >> 4) * 4u;
+    if (header < 20 || header > size)
+        return;
+    const std::uint32_t seq = be32(p + 4);
+    const std::uint8_t flags = p[13];
+
+    // connection key is always client side first, side 0 carries client to broker
+    const bool to_broker = dport == port;
+    const std::string client = (to_broker ? src : dst) + std::to_string(to_broker ? sport : dport);
+    const std::string broker = (to_broker ? dst : src) + std::to_string(port);
+    const std::string key = client + '|' + broker;
+    const char *data = reinterpret_cast<const char *>(p + header);
+    const std::size_t length = size - header;
+
+    if (flags & 0x04) { // RST
+        connections.erase(key);
+        return;
+    }
+    auto it = connections.find(key);
+    if (it == connections.end()) {
+        // e.g. the last ACK of a connection closed already
+        if (length == 0 && !(flags & 0x03))
+            return;
+        it = connections.emplace(key, Connection()).first;
+    }
+    Connection &connection = it->second;
+    Direction &d = connection.sides[to_broker ? 0 : 1];
+
+    if (flags & 0x02) { // SYN
+        d = Direction();
+        d.started = true;
+        d.base = seq + 1;
+        return;
+    }
+    segment(time, connection, d, seq, data, length);
+    if (flags & 0x01) { // FIN, possibly ahead of data still missing
+        d.fin = true;
+        d.end = seq + static_cast<std::uint32_t>(length);
+    }
+    if (connection.sides[0].finished() && connection.sides[1].finished())
+        connections.erase(it);
+}
+
+void PcapImporter::segment(double time, Connection &connection, Direction &d, std::uint32_t seq,
+                           const char *data, std::size_t length)
+{
+    if (length == 0 || d.parser.broken())
+        return;
+    if (!d.started) {
+        // picked up mid-connection, hope it starts on a packet boundary
+        d.started = true;
+        d.base = seq;
+    }
+
+    std::uint32_t offset = seq - d.base;
+    const std::int32_t ahead = static_cast<std::int32_t>(offset - d.next);
+    if (ahead < 0) {
+        const std::size_t seen = static_cast<std::size_t>(-static_cast<std::int64_t>(ahead));
+        if (seen >= length)
+            return; // retransmission
+        data += seen;
+        length -= seen;
+        offset = d.next;
+    }
+    if (offset != d.next) {
+        if (d.pending.emplace(offset, std::string(data, length)).second)
+            d.pending_bytes += length;
+        if (d.pending_bytes > MAX_PENDING) {
+            // a gap that never fills, give up on this direction
+            ++stats.skipped;
+            d = Direction();
+        }
+        return;
+    }
+
+    deliver(time, connection, d, data, length);
+    while (!d.pending.empty()) {
+        auto it = d.pending.begin();
+        const std::int32_t gap = static_cast<std::int32_t>(it->first - d.next);
+        if (gap > 0)
+            break;
+        const std::size_t seen = static_cast<std::size_t>(-static_cast<std::int64_t>(gap));
+        std::string queued = std::move(it->second);
+        d.pending_bytes -= queued.size();
+        d.pending.erase(it);
+        if (seen < queued.size())
+            deliver(time, connection, d, queued.data() + seen, queued.size() - seen);
+    }
+}
+
+void PcapImporter::deliver(double time, Connection &connection, Direction &d, const char *data, std::size_t size)
+{
+    d.next += static_cast<std::uint32_t>(size);
+    d.parser.feed(data, size);
+    while (d.parser.next(mqtt_packet)) {
+        if (mqtt_packet.type == MqttPacketType::Connect) {
+            const int version = parse_connect_version(mqtt_packet);
+            if (version)
+                connection.version = version;
+            continue;
+        }
+        if (!parse_publish(mqtt_packet, connection.version, publish)) {
+            if (mqtt_packet.type == MqttPacketType::Publish)
+                ++stats.skipped;
+            continue;
+        }
+        if (publish.topic_alias) {
+            if (!publish.topic.empty()) {
+                d.aliases[publish.topic_alias] = publish.topic;
+            } else {
+                auto it = d.aliases.find(publish.topic_alias);
+                if (it == d.aliases.end()) {
+                    ++stats.skipped;
+                    continue;
+                }
+                publish.topic = it->second;
+            }
+        }
+        writer.write(time, publish.topic, publish.payload.data(), publish.payload.size(),
+                     publish.qos, publish.retained);
+        ++stats.records;
+    }
+    if (d.parser.broken())
+        ++stats.skipped;
+}
+
+} // namespace
+
+ImportFormat import_format_for(const std::string &path)
+{
+    auto ends_with = [&path](const char *suffix) {
+        const std::size_t n = std::strlen(suffix);
+        return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+    };
+    if (ends_with(".pcap"))
+        return ImportFormat::Pcap;
+    if (ends_with(".ndjson") || ends_with(".jsonl"))
+        return ImportFormat::Ndjson;
+    return ImportFormat::MosquittoSub;
+}
+
+ImportStats import_capture(const std::string &input, const std::string &capture, ImportFormat format,
+                           unsigned threads, std::uint16_t port,
+                           const std::function<void(const ImportStats &)> &progress,
+                           const std::atomic<bool> *cancel)
+{
+    if (threads == 0)
+        threads = TaskPool::shared().size();
+
+    CaptureWriter writer(capture);
+    ImportStats stats;
+    if (format == ImportFormat::Pcap) {
+        PcapImporter pcap(writer, port);
+        pcap.run(input, progress, cancel);
+        stats = pcap.stats;
+    } else {
+        stats = import_text(input, writer, format, threads, progress, cancel);
+    }
+    writer.flush();
+    return stats;
+}
@@ -0,0 +1,44 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+enum class ImportFormat { MosquittoSub, Ndjson, Pcap };
+
+// .pcap is a packet capture, .ndjson/.jsonl NDJSON, anything else mosquitto_sub output
+ImportFormat import_format_for(const std::string &path);
+
+struct ImportStats
+{
+    std::uint64_t records = 0;
+    // lines, packets or TCP streams that could not be decoded
+    std::uint64_t skipped = 0;
+};
+
+/**
+ * Converts traffic recorded elsewhere into a capture file.
+ *
+ * - mosquitto_sub -v output: "topic payload" per line; a leading unix
+ *   timestamp as printed by -F "%U %t %p" is used as message time.
+ * - NDJSON: objects with time, topic, qos, retained and payload or
+ *   payload_base64, i.e. what export_capture() writes.
+ * - pcap: TCP segments to or from `port` are reassembled per direction
+ *   and every PUBLISH of either direction becomes a record, MQTT 5 topic
+ *   aliases included.
+ *
+ * Text formats are cut into newline-aligned chunks that are parsed as Bulk
+ * tasks of the shared TaskPool, at most 2 * threads at a time (0: the
+ * pool size), and written in order. pcap is decoded in one pass,
+ * TCP reassembly needs the segments in capture order.
+ * Throws std::runtime_error on I/O errors or an unknown pcap format, and
+ * once *cancel is set.
+ */
+ImportStats import_capture(const std::string &input, const std::string &capture, ImportFormat format,
+                           unsigned threads = 0, std::uint16_t port = 1883,
+                           const std::function<void(const ImportStats &)> &progress = {},
+                           const std::atomic<bool> *cancel = nullptr);
+
+#endif // IMPORTER_H
@@ -0,0 +1,136 @@
+#include "ingestqueue.h"
+#include <algorithm>
+#include <chrono>
+
+IngestQueue::IngestQueue(std::size_t capacity):
+    capacity(std::max<std::size_t>(capacity, 1))
+{
+}
+
+void IngestQueue::set_policy(Policy policy, unsigned sample_every)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    current = policy;
+    this->sample_every = std::max(sample_every, 1u);
+    // what is still conflated is older than anything queued from now on
+    if (policy != Policy::LatestPerTopic) {
+        std::vector<LastValueCache::Update> flushed;
+        latest.drain(flushed, latest.pending());
+        for (LastValueCache::Update &u : flushed)
+            queue.push_back(std::move(u));
+    }
+    not_full.notify_all();
+}
+
+IngestQueue::Policy IngestQueue::policy() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return current;
+}
+
+void IngestQueue::set_priorities(std::vector<std::pair<std::string, int>> priorities)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    this->priorities = std::move(priorities);
+}
+
+int IngestQueue::priority_of(const std::string &topic) const
+{
+    std::size_t longest = 0;
+    int priority = 0;
+    for (const auto &p : priorities) {
+        if (p.first.size() >= longest && topic.compare(0, p.first.size(), p.first) == 0) {
+            longest = p.first.size();
+            priority = p.second;
+        }
+    }
+    return priority;
+}
+
+void IngestQueue::shed(const mqtt::const_message_ptr &msg)
+{
+    ++stats.shed;
+    stats.shed_bytes += msg->get_payload().size();
+}
+
+void IngestQueue::put(mqtt::const_message_ptr msg)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    put(guard, std::move(msg));
+}
+
+void IngestQueue::put(const mqtt::const_message_ptr *msgs, std::size_t n)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (std::size_t i = 0; i < n; ++i)
+        put(guard, msgs[i]);
+}
+
+void IngestQueue::put(std::unique_lock<std::mutex> &guard, mqtt::const_message_ptr msg)
+{
+    const bool full = queue.size() >= capacity;
+
+    switch (current) {
+    case Policy::Block:
+        if (full) {
+            const auto start = std::chrono::steady_clock::now();
+            not_full.wait(guard, [this] { return closed || current != Policy::Block || queue.size() < capacity; });
+            stats.blocked_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        break;
+    case Policy::LatestPerTopic:
+        if (!latest.put(std::move(msg)))
+            ++stats.conflated;
+        ++stats.accepted;
+        return;
+    case Policy::Sample:
+        if (full && (++sample_count % sample_every != 0 || queue.size() >= 2 * capacity)) {
+            shed(msg);
+            return;
+        }
+        break;
+    case Policy::Priority:
+        if (full && (priority_of(msg->get_topic()) <= 0 || queue.size() >= 2 * capacity)) {
+            shed(msg);
+            return;
+        }
+        break;
+    }
+
+    LastValueCache::Update u;
+    u.msg = std::move(msg);
+    queue.push_back(std::move(u));
+    ++stats.accepted;
+}
+
+std::size_t IngestQueue::drain(std::vector<LastValueCache::Update> &out, std::size_t max)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const std::size_t n = std::min(max, queue.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        out.push_back(std::move(queue.front()));
+        queue.pop_front();
+    }
+    if (n > 0)
+        not_full.notify_all();
+    return n + latest.drain(out, max - n);
+}
+
+void IngestQueue::close()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    not_full.notify_all();
+}
+
+std::size_t IngestQueue::size() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return queue.size() + latest.pending();
+}
+
+IngestQueue::Counters IngestQueue::counters() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
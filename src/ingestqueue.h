@@ -0,0 +1,77 @@
+#ifndef INGESTQUEUE_H
+#define INGESTQUEUE_H
+
+#include <mqtt/message.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "lastvaluecache.h"
+
+/**
+ * Hand-over of messages from the paho thread to the GUI with a bounded
+ * backlog.
+ *
+ * LatestPerTopic conflates all the time: messages go to a LastValueCache,
+ * so the backlog is bounded by the number of topics, not by the rate.
+ * The other policies queue every message below `capacity` and decide what
+ * to give up above it:
+ *  - Block: the paho thread waits, which pushes back on the broker via TCP;
+ *  - Sample: only every N-th message is queued;
+ *  - Priority: only messages under a subtree with priority > 0 are queued.
+ * Sample and Priority queue nothing beyond twice the capacity.
+ */
+class IngestQueue
+{
+public:
+    enum class Policy { Block, LatestPerTopic, Sample, Priority };
+
+    struct Counters
+    {
+        std::uint64_t accepted = 0;
+        std::uint64_t shed = 0;
+        std::uint64_t shed_bytes = 0;
+        // messages replaced by a newer one of the same topic
+        std::uint64_t conflated = 0;
+        double blocked_seconds = 0;
+    };
+
+    explicit IngestQueue(std::size_t capacity = 100000);
+
+    void set_policy(Policy policy, unsigned sample_every = 10);
+    Policy policy() const;
+    // topic prefix and priority pairs, the longest matching prefix wins
+    void set_priorities(std::vector<std::pair<std::string, int>> priorities);
+
+    void put(mqtt::const_message_ptr msg);
+    void put(const mqtt::const_message_ptr *msgs, std::size_t n);
+    // oldest first; the queue is always older than the cache
+    std::size_t drain(std::vector<LastValueCache::Update> &out, std::size_t max);
+    // wakes a blocked put() for good, e.g. on shutdown
+    void close();
+
+    std::size_t size() const;
+    Counters counters() const;
+
+private:
+    void put(std::unique_lock<std::mutex> &guard, mqtt::const_message_ptr msg);
+    int priority_of(const std::string &topic) const;
+    void shed(const mqtt::const_message_ptr &msg);
+
+    mutable std::mutex lock;
+    std::condition_variable not_full;
+    std::deque<LastValueCache::Update> queue;
+    LastValueCache latest;
+    std::size_t capacity;
+    Policy current = Policy::LatestPerTopic;
+    unsigned sample_every = 10;
+    std::uint64_t sample_count = 0;
+    std::vector<std::pair<std::string, int>> priorities;
+    Counters stats;
+    bool closed = false;
+};
+
+#endif // INGESTQUEUE_H
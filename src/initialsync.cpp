@@ -0,0 +1,85 @@
+#include "initialsync.h"
+#include <chrono>
+
+InitialSync::~InitialSync()
+{
+    stop();
+}
+
+void InitialSync::start()
+{
+    stop();
+    std::lock_guard<std::mutex> guard(lock);
+    finished.reset();
+    mqtt::const_message_ptr stale;
+    while (queue.try_get(&stale))
+        ;
+    tree = std::make_shared<TopicTree>();
+    count = 0;
+    stopping = false;
+    running = true;
+    builder = std::thread(&InitialSync::build, this);
+}
+
+void InitialSync::stop()
+{
+    stopping = true;
+    if (builder.joinable())
+        builder.join();
+    running = false;
+}
+
+bool InitialSync::offer(const mqtt::const_message_ptr &msg)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!running)
+        return false;
+    queue.put(msg);
+    return true;
+}
+
+std::size_t InitialSync::offer(const mqtt::const_message_ptr *msgs, std::size_t n)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!running)
+        return 0;
+    for (std::size_t i = 0; i < n; ++i)
+        queue.put(msgs[i]);
+    return n;
+}
+
+std::shared_ptr<TopicTree> InitialSync::take()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return std::move(finished);
+}
+
+void InitialSync::build()
+{
+    const auto poll = std::chrono::duration<double>(QUIET / 4);
+    double last_retained = stats_clock();
+    auto record = [&](const mqtt::const_message_ptr &msg) {
+        const double now = stats_clock();
+        tree->record(msg, now);
+        if (msg->is_retained())
+            last_retained = now;
+        ++count;
+    };
+
+    while (!stopping) {
+        mqtt::const_message_ptr msg;
+        if (queue.try_get_for(&msg, poll))
+            record(msg);
+        // checked after every message too, live traffic may never leave the queue empty
+        if (stats_clock() - last_retained < QUIET)
+            continue;
+
+        // offer() pushes under the same lock, so nothing slips past the hand-over
+        std::lock_guard<std::mutex> guard(lock);
+        while (queue.try_get(&msg))
+            record(msg);
+        running = false;
+        finished = std::move(tree);
+        return;
+    }
+}
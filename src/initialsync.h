@@ -0,0 +1,53 @@
+#ifndef INITIALSYNC_H
+#define INITIALSYNC_H
+
+#include <mqtt/message.h>
+#include <mqtt/thread_queue.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "topictree.h"
+
+/**
+ * Bulk load of the retained-message burst that follows subscribing.
+ *
+ * While active, offer() takes every message from the paho thread and a
+ * builder thread records it into a private TopicTree, so the GUI sees no
+ * per-message work at all. A broker only sets the retain flag on messages
+ * it replays from its store, so once no retained message has arrived for
+ * QUIET seconds the burst is over and the finished tree waits in take().
+ */
+class InitialSync
+{
+public:
+    static constexpr double QUIET = 0.3;
+
+    InitialSync() = default;
+    ~InitialSync();
+
+    void start();
+    void stop();
+
+    bool offer(const mqtt::const_message_ptr &msg);
+    // takes a prefix of msgs, all of them unless the burst ended; returns its length
+    std::size_t offer(const mqtt::const_message_ptr *msgs, std::size_t n);
+    bool active() const { return running; }
+    std::size_t received() const { return count; }
+    // the finished tree, once; messages refused by offer() are newer than all of it
+    std::shared_ptr<TopicTree> take();
+
+private:
+    void build();
+
+    std::mutex lock;
+    mqtt::thread_queue<mqtt::const_message_ptr> queue;
+    std::shared_ptr<TopicTree> tree;
+    std::shared_ptr<TopicTree> finished;
+    std::thread builder;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<std::size_t> count{0};
+};
+
+#endif // INITIALSYNC_H
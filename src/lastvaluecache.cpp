@@ -0,0 +1,74 @@
+#include "lastvaluecache.h"
+#include <algorithm>
+#include <functional>
+
+LastValueCache::LastValueCache():
+    slots(1024, 0)
+{
+}
+
+std::uint32_t LastValueCache::intern(const std::string &topic)
+{
+    const std::size_t hash = std::hash<std::string>()(topic);
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+    for (; slots[i]; i = (i + 1) & mask) {
+        const Entry &e = entries[slots[i] - 1];
+        if (e.hash == hash && e.topic == topic)
+            return slots[i] - 1;
+    }
+
+    const std::uint32_t id = static_cast<std::uint32_t>(entries.size());
+    entries.emplace_back();
+    entries.back().topic = topic;
+    entries.back().hash = hash;
+    slots[i] = id + 1;
+    if (entries.size() * 2 > slots.size())
+        grow();
+    return id;
+}
+
+void LastValueCache::grow()
+{
+    slots.assign(slots.size() * 2, 0);
+    const std::size_t mask = slots.size() - 1;
+    for (std::uint32_t id = 0; id < entries.size(); ++id) {
+        std::size_t i = entries[id].hash & mask;
+        while (slots[i])
+            i = (i + 1) & mask;
+        slots[i] = id + 1;
+    }
+}
+
+bool LastValueCache::put(mqtt::const_message_ptr msg)
+{
+    Entry &e = entries[intern(msg->get_topic())];
+    if (e.queued) {
+        ++e.update.folded;
+        e.update.folded_bytes += e.update.msg->get_payload().size();
+        e.update.msg = std::move(msg);
+        return false;
+    }
+    e.update.msg = std::move(msg);
+    e.queued = true;
+    changed.push_back(static_cast<std::uint32_t>(&e - entries.data()));
+    return true;
+}
+
+std::size_t LastValueCache::drain(std::vector<Update> &out, std::size_t max)
+{
+    const std::size_t n = std::min(max, pending());
+    for (std::size_t i = next; i < next + n; ++i) {
+        Entry &e = entries[changed[i]];
+        out.push_back(std::move(e.update));
+        e.update = Update();
+        e.queued = false;
+    }
+    next += n;
+    // a backlog that never empties must not grow the list forever
+    if (next * 2 >= changed.size()) {
+        changed.erase(changed.begin(), changed.begin() + next);
+        next = 0;
+    }
+    return n;
+}
@@ -0,0 +1,63 @@
+#ifndef LASTVALUECACHE_H
+#define LASTVALUECACHE_H
+
+#include <mqtt/message.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Pending latest message per topic, conflated until the GUI takes it.
+ *
+ * Topics are interned once into dense ids by an open-addressing table
+ * (linear probing, hashes kept with the entries so growing never hashes a
+ * string again). A message whose topic is already pending just replaces
+ * it; otherwise its id joins the changed list. drain() walks that list
+ * only, so both memory and GUI work follow the number of distinct topics
+ * rather than the message rate.
+ *
+ * Not synchronised, the owner locks around it.
+ */
+class LastValueCache
+{
+public:
+    struct Update
+    {
+        mqtt::const_message_ptr msg;
+        // older messages of the topic that msg replaced before being drained
+        std::uint32_t folded = 0;
+        std::uint64_t folded_bytes = 0;
+    };
+
+    LastValueCache();
+
+    // false if msg replaced a pending message of the same topic
+    bool put(mqtt::const_message_ptr msg);
+    std::size_t drain(std::vector<Update> &out, std::size_t max);
+
+    std::size_t pending() const { return changed.size() - next; }
+    std::size_t topics() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::string topic;
+        std::size_t hash = 0;
+        Update update;
+        bool queued = false;
+    };
+
+    std::uint32_t intern(const std::string &topic);
+    void grow();
+
+    // by topic id
+    std::vector<Entry> entries;
+    // topic id + 1 per slot, 0 is empty; at most half full
+    std::vector<std::uint32_t> slots;
+    // ids in the order of their first pending message
+    std::vector<std::uint32_t> changed;
+    // drained prefix of changed
+    std::size_t next = 0;
+};
+
+#endif // LASTVALUECACHE_H
@@ -1,11 +1,17 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "startup.h"
+#include <QDir>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QStatusBar>
 
 MainWindow::MainWindow(QWidget *parent):
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    startup_mark("MainWindow::setupUi");
 }
 
 MainWindow::~MainWindow()
@@ -13,6 +19,15 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+std::string MainWindow::snapshot_path(const std::string &address)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    QString name = QString::fromStdString(address);
+    name.replace(QRegularExpression("[^A-Za-z0-9._-]"), "_");
+    return (dir + "/" + name + ".mqsnap").toStdString();
+}
+
 
 void MainWindow::on_connectBroker_clicked()
 {
@@ -23,25 +38,57 @@ void MainWindow::on_connectBroker_clicked()
     const std::string  password = ui->password->text().toStdString();
 
     const std::string address = protocol + host + port;
+    startup_mark("connect clicked");
 
-    mqtt::async_client client = mqtt::async_client(address, user);
+    const bool v5 = ui->mqttV5->isChecked();
+    mqtt::create_options createOpts;
+    createOpts.set_mqtt_verison(v5 ? MQTTVERSION_5 : MQTTVERSION_DEFAULT);
+    client = std::make_unique<mqtt::async_client>(address, user, createOpts);
     mqtt::connect_options connOpts;
     connOpts.set_keep_alive_interval(std::chrono::seconds(20));
-    connOpts.set_clean_session(true);
+    if (v5) {
+        connOpts.set_mqtt_version(MQTTVERSION_5);
+        connOpts.set_clean_start(true);
+        // lets the broker send a topic once and refer to it by number afterwards;
+        // a session that outlives the connection spares the resync after a short outage
+        connOpts.set_properties({mqtt::property(mqtt::property::TOPIC_ALIAS_MAXIMUM, TopicAliases::MAXIMUM),
+                                 mqtt::property(mqtt::property::SESSION_EXPIRY_INTERVAL, MainMenu::SESSION_EXPIRY)});
+    } else {
+        connOpts.set_clean_session(true);
+    }
+
+    // the menu has to be listening before the first message can arrive; it is
+    // shown right away, with the snapshot filling in while the broker answers
+    main_menu = new MainMenu(this);
+    main_menu->set_snapshot(snapshot_path(address));
+    main_menu->display_topics(*client, connOpts);
+    hide();
+    main_menu->show();
+    startup_mark("MainMenu");
 
+    connect_broker(host, std::move(connOpts));
+}
+
+Detached MainWindow::connect_broker(std::string host, mqtt::connect_options options)
+{
+    ui->connectBroker->setEnabled(false);
     try {
         std::cout << "Connecting to the server at " << host << std::endl;
-        client.connect(connOpts);
+        TokenAwait<mqtt::token_ptr> connected = await_connect(this, *client, std::move(options));
+        startup_mark("connect sent");
+        const mqtt::token_ptr token = co_await connected;
         std::cout << "Success. " << host << std::endl;
-    } catch(const mqtt::exception& exc) {
+        main_menu->connected(token->get_connect_response().is_session_present());
+    } catch (const mqtt::exception &exc) {
         std::cerr << "Error: " << exc.what() << " ["
-                    << exc.get_reason_code() << "]" << std::endl;
-                throw exc;
+                  << exc.get_reason_code() << "]" << std::endl;
+        statusBar()->showMessage(tr("Cannot connect to %1: %2").arg(QString::fromStdString(host), exc.what()));
+        // the menu refers to the client, it goes first
+        delete main_menu;
+        main_menu = nullptr;
+        client.reset();
+        ui->connectBroker->setEnabled(true);
+        show();
+        co_return;
     }
-
-    //opens new window with topics and messages
-    hide();
-    main_menu = new MainMenu(this);
-    main_menu->show();
-    main_menu->display_topics(client);
 }
@@ -1,31 +1,666 @@
 #include "mainmenu.h"
 #include "ui_mainmenu.h"
+#include <QActionGroup>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QTimer>
 #include <mqtt/async_client.h>
 #include <mqtt/topic.h>
+#include "exporter.h"
+#include "importer.h"
+#include "snapshot.h"
+#include "startup.h"
+#include "taskpool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+bool parse_number(const std::string &payload, double &value)
+{
+    const char *begin = payload.c_str();
+    char *end = nullptr;
+    value = std::strtod(begin, &end);
+    if (end == begin)
+        return false;
+    while (std::isspace(static_cast<unsigned char>(*end)))
+        ++end;
+    return *end == '\0';
+}
+
+} // namespace
 
 MainMenu::MainMenu(QWidget *parent):
     QMainWindow(parent),
-    ui(new Ui::MainMenu)
+    ui(new Ui::MainMenu),
+    model(new TopicModel(this)),
+    refresh(new QTimer(this)),
+    ingest_timer(new QTimer(this)),
+    started(std::chrono::steady_clock::now()),
+    checkpoint_timer(new QTimer(this)),
+    batches([this](const mqtt::const_message_ptr *msgs, std::size_t n) { on_batch(msgs, n); })
 {
     ui->setupUi(this);
+    ui->topics->setModel(model);
+    connect(checkpoint_timer, &QTimer::timeout, this, &MainMenu::save_snapshot);
+
+    connect(refresh, &QTimer::timeout, ui->topics->viewport(), qOverload<>(&QWidget::update));
+    connect(refresh, &QTimer::timeout, this, &MainMenu::update_talkers);
+    connect(refresh, &QTimer::timeout, this, [this] { model->tree().expire(stats_clock()); });
+    connect(refresh, &QTimer::timeout, this, &MainMenu::update_status);
+    connect(ui->talkersMetric, qOverload<int>(&QComboBox::currentIndexChanged), this, &MainMenu::update_talkers);
+    refresh->start(1000);
+
+    QActionGroup *policies = new QActionGroup(this);
+    for (QAction *action : {ui->actionPolicyLatest, ui->actionPolicySample, ui->actionPolicyPriority, ui->actionPolicyBlock})
+        policies->addAction(action);
+    connect(policies, &QActionGroup::triggered, this, &MainMenu::set_policy);
+
+    connect(ingest_timer, &QTimer::timeout, this, &MainMenu::drain_ingest);
+    ingest_timer->start(16);
+
+    subscriptions.set({SubscriptionManager::Filter{"#", 0, {}}});
 }
 
 MainMenu::~MainMenu()
 {
+    // the handler may block in a full ingest queue that only this thread drains,
+    // so it is released first; stop() waits for the batch it is handling
+    ingest.close();
+    sync.stop();
+    batches.stop();
+    // their results are queued to this window, which must outlive them;
+    // a running export or import stops early instead of finishing first
+    cancelled = true;
+    for (std::future<void> &task : background)
+        task.wait();
+    // skipped while restoring, which must not overwrite the file with an empty tree
+    save_snapshot();
     delete ui;
 }
 
-void MainMenu::display_topics(mqtt::async_client &client)
+void MainMenu::set_snapshot(const std::string &path)
+{
+    snapshot_path = path;
+    // subscribing waits until the restored tree is adopted, see connected()
+    restoring = true;
+    run_background(TaskPool::Priority::Normal, [this, path] {
+        auto tree = std::make_shared<TopicTree>();
+        try {
+            if (!load_snapshot(path, *tree))
+                tree.reset();
+        } catch (const std::exception &exc) {
+            std::cerr << "Error: " << exc.what() << std::endl;
+            tree.reset();
+        }
+        QMetaObject::invokeMethod(this, [this, tree] { restore_finished(tree); }, Qt::QueuedConnection);
+    });
+    checkpoint_timer->start(CHECKPOINT_MS);
+}
+
+void MainMenu::run_background(TaskPool::Priority priority, std::function<void()> task)
+{
+    background.erase(std::remove_if(background.begin(), background.end(), [](const std::future<void> &f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), background.end());
+    background.push_back(TaskPool::shared().submit(priority, std::move(task)));
+}
+
+void MainMenu::restore_finished(std::shared_ptr<TopicTree> tree)
+{
+    restoring = false;
+    if (tree) {
+        model->adopt(std::move(*tree));
+        // the retained burst updates it in place instead of replacing it
+        synced = true;
+        statusBar()->showMessage(tr("Restored %1 topic levels").arg(model->tree().size() - 1));
+    }
+    // the ids of the adopted tree need not match the file
+    snapshot_full = true;
+    if (deferred_connect) {
+        deferred_connect = false;
+        connected(deferred_session);
+    }
+}
+
+void MainMenu::save_snapshot()
+{
+    if (snapshot_path.empty() || restoring)
+        return;
+    try {
+        // rewrite once the checkpoints outgrow the snapshot they amend
+        const bool full = snapshot_full || checkpoint_bytes > snapshot_bytes;
+        const std::size_t written = ::save_snapshot(snapshot_path, model->tree(), full);
+        if (full) {
+            snapshot_bytes = written;
+            checkpoint_bytes = 0;
+            snapshot_full = false;
+        } else {
+            checkpoint_bytes += written;
+        }
+    } catch (const std::exception &exc) {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        snapshot_full = true;
+    }
+}
+
+void MainMenu::display_topics(mqtt::async_client &client, const mqtt::connect_options &options)
+{
+    this->client = &client;
+    reconnect_options = options;
+    // an MQTT 5 broker may still hold the session then; 3.1.1 has no expiry, so it stays clean
+    if (options.get_mqtt_version() == MQTTVERSION_5)
+        reconnect_options.set_clean_start(false);
+
+    // paho delivers on its own thread in batches, the GUI drains the ingest queue on a timer
+    client.set_callback(batches);
+    client.set_connected_handler([this](const std::string &) {
+        ++connection;
+        startup_mark("connected");
+    });
+    client.set_connection_lost_handler([this](const std::string &) {
+        subscriptions.disconnected();
+        clearing.stop();
+        QMetaObject::invokeMethod(this, [this] { reconnect(); }, Qt::QueuedConnection);
+    });
+}
+
+void MainMenu::connected(bool session_present)
+{
+    connecting = false;
+    // whether the burst builds a new tree depends on the restore
+    if (restoring) {
+        deferred_connect = true;
+        deferred_session = session_present;
+        return;
+    }
+    // an empty tree is filled by the retained burst in one go
+    if (!synced.exchange(true)) {
+        sync.start();
+    } else if (session_present) {
+        // the broker kept the subscriptions, there is no replay to wait for
+        resync.stop();
+    } else if (model->tree().size() > 1) {
+        // the replay mostly repeats the tree; only what it changes is queued
+        model->tree().begin_resync();
+        resync.start();
+    }
+    subscriptions.connected(*client, session_present);
+}
+
+Detached MainMenu::reconnect()
+{
+    if (reconnecting)
+        co_return;
+    reconnecting = true;
+    for (;;) {
+        const double delay = backoff.next();
+        update_status();
+        co_await after(this, delay);
+        try {
+            mqtt::token_ptr token = co_await await_connect(this, *client, reconnect_options);
+            reconnecting = false;
+            backoff.reset();
+            connected(token->get_connect_response().is_session_present());
+            update_status();
+            co_return;
+        } catch (const mqtt::exception &exc) {
+            std::cerr << "Error: " << exc.what() << " [" << exc.get_reason_code() << "]" << std::endl;
+        }
+    }
+}
+
+void MainMenu::on_batch(const mqtt::const_message_ptr *msgs, std::size_t n)
+{
+    startup_mark("first batch");
+    const unsigned current = connection.load();
+    if (current != aliases_connection) {
+        aliases.reset();
+        aliases_connection = current;
+    }
+    resolved.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+        ConcurrentTopicTrie::Node *node;
+        mqtt::const_message_ptr msg = aliases.resolve(msgs[i], node);
+        if (!msg)
+            continue;
+        // an unchanged replay leaves even the live value as it was
+        if (resync.replayed(node, msg))
+            continue;
+        live.update(node, msg);
+        resolved.push_back(std::move(msg));
+    }
+    msgs = resolved.data();
+    n = resolved.size();
+
+    talkers.record(msgs, n, stats_clock());
+    record_capture(msgs, n);
+    const std::size_t taken = sync.offer(msgs, n);
+    ingest.put(msgs + taken, n - taken);
+}
+
+void MainMenu::record_capture(const mqtt::const_message_ptr *msgs, std::size_t n)
+{
+    std::lock_guard<std::mutex> guard(capture_lock);
+    if (!capture)
+        return;
+    const std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+    try {
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::string &payload = msgs[i]->get_payload();
+            capture->write(now.count(), msgs[i]->get_topic(), payload.data(), payload.size(),
+                           msgs[i]->get_qos(), msgs[i]->is_retained());
+        }
+    } catch (const std::exception &exc) {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        capture.reset();
+    }
+}
+
+void MainMenu::on_message(LastValueCache::Update update)
+{
+    const mqtt::const_message_ptr msg = std::move(update.msg);
+    TopicTree::Node *node = model->record(msg);
+    node->stats.fold(stats_clock(), update.folded, update.folded_bytes);
+    if (msg->get_topic() == selected_topic) {
+        // the selection follows the delivered value, not the possibly conflated queue
+        mqtt::const_message_ptr current = live.find(selected_topic);
+        if (current && current != selected_after) {
+            selected_before = std::move(selected_after);
+            selected_after = std::move(current);
+            show_selected(true);
+        }
+    }
+
+    auto it = series.find(msg->get_topic());
+    if (it == series.end())
+        return;
+
+    double value;
+    if (!parse_number(msg->get_payload_str(), value))
+        return;
+
+    const std::chrono::duration<double> t = std::chrono::steady_clock::now() - started;
+    it->second.append(t.count(), value);
+    if (it->first == plotted)
+        ui->plot->series_changed();
+}
+
+void MainMenu::on_plotTopic_editingFinished()
+{
+    plotted = ui->plotTopic->text().toStdString();
+    if (plotted.empty()) {
+        ui->plot->set_series(nullptr);
+        return;
+    }
+    ui->plot->set_series(&series[plotted]);
+}
+
+void MainMenu::on_plotLttb_toggled(bool checked)
+{
+    ui->plot->set_mode(checked ? PlotWidget::Mode::Lttb : PlotWidget::Mode::MinMax);
+}
+
+void MainMenu::on_topics_clicked(const QModelIndex &index)
+{
+    const TopicTree::Node *node = model->node(index);
+    std::string topic = model->tree().path(node);
+    const bool same_topic = topic == selected_topic;
+    selected_topic = std::move(topic);
+    selected_before.reset();
+    selected_after = live.find(selected_topic);
+    if (!selected_after)
+        selected_after = node->message;
+    show_selected(same_topic);
+}
+
+void MainMenu::on_messageHex_toggled(bool checked)
+{
+    ui->message->set_mode(checked ? PayloadView::Mode::Hex : PayloadView::Mode::Auto);
+}
+
+void MainMenu::show_selected(bool same_topic)
+{
+    if (!selected_after) {
+        ui->message->clear();
+        ui->diff->clear();
+        return;
+    }
+    ui->message->set_payload(selected_after->get_payload_ref(), same_topic);
+    if (!selected_before) {
+        ui->diff->clear();
+        return;
+    }
+
+    auto it = diffs.find(selected_after.get());
+    if (it != diffs.end()) {
+        ui->diff->setPlainText(it->second.diff->to_text());
+        return;
+    }
+    diff_pending = DiffEntry{selected_before, selected_after, nullptr};
+    if (!diff_running.after)
+        start_diff();
+}
+
+void MainMenu::start_diff()
+{
+    diff_running = std::move(diff_pending);
+    diff_pending = DiffEntry();
+    mqtt::const_message_ptr before = diff_running.before, after = diff_running.after;
+    // the row being looked at, ahead of any export or restore
+    run_background(TaskPool::Priority::Interactive, [this, before, after] {
+        auto diff = std::make_shared<const MessageDiff>(
+                    MessageDiff::compute(before->get_payload_str(), after->get_payload_str()));
+        QMetaObject::invokeMethod(this, [this, diff] { diff_finished(diff); }, Qt::QueuedConnection);
+    });
+}
+
+void MainMenu::diff_finished(std::shared_ptr<const MessageDiff> diff)
 {
-    //mqtt::topic topic = mqtt::topic(client, "$SYS/broker/heap", 1);
-    //auto subOpts = mqtt::subscribe_options(true);
+    diff_running.diff = std::move(diff);
+    if (diffs.size() >= DIFF_CACHE)
+        diffs.clear();
+    const mqtt::message *key = diff_running.after.get();
+    diffs[key] = std::move(diff_running);
+    diff_running = DiffEntry();
+
+    if (selected_after.get() == key)
+        ui->diff->setPlainText(diffs[key].diff->to_text());
+    // updates that arrived meanwhile only leave their newest pair behind
+    if (diff_pending.after)
+        start_diff();
+}
+
+void MainMenu::update_talkers()
+{
+    static const int ROWS = 20;
+    const int choice = ui->talkersMetric->currentIndex();
+    const auto scope = choice >= 2 ? TopTalkers::Scope::Subtrees : TopTalkers::Scope::Topics;
+    const auto metric = choice % 2 ? TopTalkers::Metric::Bytes : TopTalkers::Metric::Messages;
+
+    const std::vector<TopTalkers::Talker> top = talkers.top(scope, metric, ROWS, stats_clock());
+    ui->talkers->setRowCount(static_cast<int>(top.size()));
+    for (int row = 0; row < static_cast<int>(top.size()); ++row) {
+        ui->talkers->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(top[row].topic)));
+        ui->talkers->setItem(row, 1, new QTableWidgetItem(QString::number(top[row].rate, 'f', 1)));
+    }
+}
+
+void MainMenu::update_status()
+{
+    if (connecting) {
+        statusBar()->showMessage(tr("Connecting, %1 topic levels restored so far").arg(model->tree().size() - 1));
+        return;
+    }
+    if (reconnecting) {
+        statusBar()->showMessage(tr("Connection lost, reconnect attempt %1").arg(backoff.attempts()));
+        return;
+    }
+    if (sync.active()) {
+        statusBar()->showMessage(tr("Initial sync: %1 messages").arg(sync.received()));
+        return;
+    }
+    if (resync.active()) {
+        statusBar()->showMessage(tr("Resync: %1 retained topics unchanged").arg(resync.confirmed()));
+        return;
+    }
+    const RetainedClear::Progress cleared = clearing.progress();
+    if (cleared.running) {
+        statusBar()->showMessage(tr("Clearing retained: %1 of %2 topics, %3/s")
+                                 .arg(cleared.acknowledged + cleared.failed).arg(cleared.total)
+                                 .arg(cleared.acknowledged / std::max(cleared.seconds, 1e-3), 0, 'f', 0));
+        return;
+    }
+    const IngestQueue::Counters c = ingest.counters();
+    QString status = tr("%1 topic levels, %2 queued, %3 shed (%4 bytes), %5 conflated, %6 s blocked")
+            .arg(model->tree().size() - 1).arg(ingest.size())
+            .arg(c.shed).arg(c.shed_bytes).arg(c.conflated)
+            .arg(c.blocked_seconds, 0, 'f', 1);
+    const SubscriptionManager::Counters s = subscriptions.counters();
+    if (s.pending > 0)
+        status += tr(", %1 subscriptions pending").arg(s.pending);
+    if (s.refused > 0)
+        status += tr(", %1 subscriptions refused").arg(s.refused);
+    if (stale_topics > 0)
+        status += tr(", %1 retained topics stale").arg(stale_topics);
+    if (model->tree().expired() > 0)
+        status += tr(", %1 topics expired").arg(model->tree().expired());
+    if (cleared.total > 0)
+        status += tr(", %1 retained cleared in %2 s (%3 failed)")
+                .arg(cleared.acknowledged).arg(cleared.seconds, 0, 'f', 1).arg(cleared.failed);
+    const TopicAliases::Counters a = aliases.counters();
+    if (a.bound > 0)
+        status += tr(", %1 % by topic alias (%2 bound, %3 unknown)")
+                .arg(100.0 * a.hits / a.messages, 0, 'f', 1).arg(a.bound).arg(a.unknown);
+    statusBar()->showMessage(status);
+}
+
+void MainMenu::on_actionRecord_toggled(bool checked)
+{
+    if (!checked) {
+        std::lock_guard<std::mutex> guard(capture_lock);
+        capture.reset();
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, tr("Record capture"), QString(),
+                                                      tr("Captures (*.mqcap)"));
     try {
-       //topic.subscribe(subOpts)->wait();
-       std::cout << "OK" << std::endl;
-    }  catch (const mqtt::exception& exc) {
-        std::cerr << "Error: " << exc.what() << " ["
-                    << exc.get_reason_code() << "]" << std::endl;
-        std::cout << "FAIL" << std::endl;
+        if (path.isEmpty())
+            throw std::runtime_error("no capture file chosen");
+        auto writer = std::make_unique<CaptureWriter>(path.toStdString());
+        std::lock_guard<std::mutex> guard(capture_lock);
+        capture = std::move(writer);
+    } catch (const std::exception &exc) {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        ui->actionRecord->setChecked(false);
+    }
+}
+
+void MainMenu::on_actionExport_triggered()
+{
+    const QString input = QFileDialog::getOpenFileName(this, tr("Export capture"), QString(),
+                                                       tr("Captures (*.mqcap)"));
+    if (input.isEmpty())
+        return;
+    const QString output = QFileDialog::getSaveFileName(this, tr("Export to"), QString(),
+                                                        tr("CSV (*.csv);;NDJSON (*.ndjson);;Columnar (*.mqcol)"));
+    if (output.isEmpty())
+        return;
+
+    const std::string in = input.toStdString(), out = output.toStdString();
+    run_background(TaskPool::Priority::Bulk, [this, in, out] {
+        auto report = [this](const QString &text) {
+            QMetaObject::invokeMethod(this, [this, text] { statusBar()->showMessage(text); }, Qt::QueuedConnection);
+        };
+        try {
+            const ExportStats stats = export_capture(in, out, export_format_for(out), 0, [&report](const ExportStats &s) {
+                report(tr("Exporting: %1 messages").arg(s.records));
+            }, &cancelled);
+            report(tr("Exported %1 messages, %2 bytes").arg(stats.records).arg(stats.bytes));
+        } catch (const std::exception &exc) {
+            report(tr("Export failed: %1").arg(exc.what()));
+        }
+    });
+}
+
+void MainMenu::on_actionImport_triggered()
+{
+    const QString input = QFileDialog::getOpenFileName(this, tr("Import traffic dump"), QString(),
+                                                       tr("Dumps (*.pcap *.ndjson *.jsonl *.txt *.log);;All files (*)"));
+    if (input.isEmpty())
         return;
+    const QString output = QFileDialog::getSaveFileName(this, tr("Save capture"), QString(),
+                                                        tr("Captures (*.mqcap)"));
+    if (output.isEmpty())
+        return;
+
+    const std::string in = input.toStdString(), out = output.toStdString();
+    run_background(TaskPool::Priority::Bulk, [this, in, out] {
+        auto report = [this](const QString &text) {
+            QMetaObject::invokeMethod(this, [this, text] { statusBar()->showMessage(text); }, Qt::QueuedConnection);
+        };
+        try {
+            const ImportStats stats = import_capture(in, out, import_format_for(in), 0, 1883, [&report](const ImportStats &s) {
+                report(tr("Importing: %1 messages").arg(s.records));
+            }, &cancelled);
+            report(tr("Imported %1 messages, %2 skipped").arg(stats.records).arg(stats.skipped));
+        } catch (const std::exception &exc) {
+            report(tr("Import failed: %1").arg(exc.what()));
+        }
+    });
+}
+
+void MainMenu::on_actionSubscriptions_triggered()
+{
+    QStringList lines;
+    for (const SubscriptionManager::Filter &filter : subscriptions.wanted())
+        lines << QString::fromStdString(filter.filter) + (filter.qos ? QString("=%1").arg(filter.qos) : QString());
+    lines.sort();
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, tr("Subscriptions"),
+                                                        tr("one filter per line, filter=qos for QoS 1 or 2"),
+                                                        lines.join('\n'), &ok);
+    if (!ok)
+        return;
+
+    // only the difference to the current set goes to the broker
+    std::vector<SubscriptionManager::Filter> wanted;
+    for (const QString &line : text.split('\n', Qt::SkipEmptyParts)) {
+        SubscriptionManager::Filter filter;
+        QString topic = line.trimmed();
+        const int eq = topic.lastIndexOf('=');
+        bool numeric = false;
+        const int qos = eq > 0 ? topic.mid(eq + 1).trimmed().toInt(&numeric) : 0;
+        if (numeric && qos >= 0 && qos <= 2) {
+            filter.qos = qos;
+            topic = topic.left(eq).trimmed();
+        }
+        if (topic.isEmpty())
+            continue;
+        filter.filter = topic.toStdString();
+        wanted.push_back(std::move(filter));
+    }
+    subscriptions.set(std::move(wanted));
+}
+
+void MainMenu::on_actionExpiry_triggered()
+{
+    bool ok = false;
+    const double seconds = QInputDialog::getDouble(this, tr("Topic expiry"),
+                                                   tr("seconds without a message before a topic is grayed out, 0 for never; "
+                                                      "MQTT 5 messages also expire with their expiry interval"),
+                                                   model->tree().idle_expiry(), 0, 1e7, 0, &ok);
+    if (ok)
+        model->tree().set_idle_expiry(seconds);
+}
+
+void MainMenu::on_actionClearRetained_triggered()
+{
+    const QModelIndex index = ui->topics->currentIndex();
+    if (!index.isValid()) {
+        statusBar()->showMessage(tr("Select the subtree to clear first"));
+        return;
+    }
+    TopicTree::Node *top = model->node(index);
+    const QString path = QString::fromStdString(model->tree().path(top));
+    // as far as the tree knows, also those republished live since; stale ones
+    // are gone from the broker already
+    std::vector<std::string> topics;
+    std::vector<TopicTree::Node *> pending{top};
+    while (!pending.empty()) {
+        TopicTree::Node *node = pending.back();
+        pending.pop_back();
+        if (node->retained && !node->stale)
+            topics.push_back(node->message->get_topic());
+        pending.insert(pending.end(), node->children.begin(), node->children.end());
+    }
+    if (topics.empty()) {
+        statusBar()->showMessage(tr("No retained messages below %1").arg(path));
+        return;
+    }
+
+    bool ok = false;
+    const int window = QInputDialog::getInt(this, tr("Clear retained"),
+                                            tr("Delete the retained messages of %1 topics below %2 from the broker, "
+                                               "with this many deletes outstanding at a time")
+                                            .arg(topics.size()).arg(path),
+                                            clear_window, 1, 65535, 1, &ok);
+    if (!ok || !client)
+        return;
+    clear_window = window;
+    clearing.start(*client, std::move(topics), static_cast<std::size_t>(clear_window));
+    update_status();
+}
+
+void MainMenu::drain_ingest()
+{
+    // while the burst is built nothing is queued; checked before take() so a
+    // tree handed over in between is adopted before the messages refused after it
+    if (sync.active() || restoring)
+        return;
+    if (std::shared_ptr<TopicTree> tree = sync.take()) {
+        model->adopt(std::move(*tree));
+        snapshot_full = true;
+        update_status();
+    }
+
+    ingest.drain(drained, DRAIN_PER_TICK);
+    for (LastValueCache::Update &update : drained)
+        on_message(std::move(update));
+    drained.clear();
+    for (const std::string &topic : clearing.take_cleared()) {
+        if (TopicTree::Node *node = model->tree().find(topic))
+            node->retained = false;
+    }
+    if (resync.active())
+        finish_resync();
+}
+
+void MainMenu::finish_resync()
+{
+    TopicTree &tree = model->tree();
+    for (const mqtt::string_ref &topic : resync.take_confirmed()) {
+        if (TopicTree::Node *node = tree.find(topic.str()))
+            tree.confirm(node);
+    }
+    // changed replays are recorded by now, so whatever was not heard of is gone
+    if (!resync.quiet() || !subscriptions.idle() || ingest.size() > 0)
+        return;
+    resync.stop();
+    stale_topics = tree.end_resync();
+    update_status();
+}
+
+void MainMenu::set_policy(QAction *action)
+{
+    if (action == ui->actionPolicySample)
+        ingest.set_policy(IngestQueue::Policy::Sample);
+    else if (action == ui->actionPolicyPriority)
+        ingest.set_policy(IngestQueue::Policy::Priority);
+    else if (action == ui->actionPolicyBlock)
+        ingest.set_policy(IngestQueue::Policy::Block);
+    else
+        ingest.set_policy(IngestQueue::Policy::LatestPerTopic);
+}
+
+void MainMenu::on_actionPriorities_triggered()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Subtree priorities"),
+                                               tr("prefix=priority, separated by commas; "
+                                                  "only priorities above 0 survive an overload"),
+                                               QLineEdit::Normal, QString(), &ok);
+    if (!ok)
+        return;
+
+    std::vector<std::pair<std::string, int>> priorities;
+    for (const QString &item : text.split(',', Qt::SkipEmptyParts)) {
+        const int eq = item.lastIndexOf('=');
+        if (eq <= 0)
+            continue;
+        priorities.emplace_back(item.left(eq).trimmed().toStdString(), item.mid(eq + 1).trimmed().toInt());
     }
+    ingest.set_priorities(std::move(priorities));
 }
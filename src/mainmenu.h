@@ -3,6 +3,34 @@
 
 #include <QMainWindow>
 #include <mqtt/async_client.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "backoff.h"
+#include "batchcallback.h"
+#include "capture.h"
+#include "concurrenttrie.h"
+#include "ingestqueue.h"
+#include "initialsync.h"
+#include "messagediff.h"
+#include "resync.h"
+#include "retainedclear.h"
+#include "seriespyramid.h"
+#include "subscriptions.h"
+#include "taskpool.h"
+#include "tokenawait.h"
+#include "topicalias.h"
+#include "topicmodel.h"
+#include "toptalkers.h"
+
+class QAction;
+class QTimer;
 
 namespace Ui {
 class MainMenu;
@@ -13,14 +41,130 @@ class MainMenu : public QMainWindow
     Q_OBJECT
 
 public:
+    // seconds an MQTT 5 broker keeps the session after the connection is lost
+    static const unsigned SESSION_EXPIRY = 600;
+
     explicit MainMenu(QWidget *parent = nullptr);
     ~MainMenu();
 
     void set_topic();
-    void display_topics(mqtt::async_client &client);
+    // restores the tree saved at path, in the background, and keeps saving to it
+    void set_snapshot(const std::string &path);
+    // options are those of the first connect, reconnects reuse them
+    void display_topics(mqtt::async_client &client, const mqtt::connect_options &options);
+    // the broker accepted a connect; subscribes what the session lacks
+    void connected(bool session_present);
+
+private slots:
+    void on_plotTopic_editingFinished();
+    void on_plotLttb_toggled(bool checked);
+    void on_topics_clicked(const QModelIndex &index);
+    void on_messageHex_toggled(bool checked);
+    void update_talkers();
+    void update_status();
+    void on_actionRecord_toggled(bool checked);
+    void on_actionExport_triggered();
+    void on_actionImport_triggered();
+    void on_actionPriorities_triggered();
+    void on_actionSubscriptions_triggered();
+    void on_actionExpiry_triggered();
+    void on_actionClearRetained_triggered();
+    void set_policy(QAction *action);
+    void drain_ingest();
+    void save_snapshot();
 
 private:
+    void on_batch(const mqtt::const_message_ptr *msgs, std::size_t n);
+    void record_capture(const mqtt::const_message_ptr *msgs, std::size_t n);
+    void on_message(LastValueCache::Update update);
+    void show_selected(bool same_topic);
+    void start_diff();
+    void diff_finished(std::shared_ptr<const MessageDiff> diff);
+    void restore_finished(std::shared_ptr<TopicTree> tree);
+    // until connected again, with backoff between the attempts
+    Detached reconnect();
+    void finish_resync();
+    // on the shared pool; results come back queued to this window
+    void run_background(TaskPool::Priority priority, std::function<void()> task);
+
+    struct DiffEntry
+    {
+        // keeps both messages alive, so the key address cannot be reused
+        mqtt::const_message_ptr before;
+        mqtt::const_message_ptr after;
+        std::shared_ptr<const MessageDiff> diff;
+    };
+    static const std::size_t DIFF_CACHE = 256;
+    // messages handled per drain tick, the rest waits in the ingest queue
+    static const std::size_t DRAIN_PER_TICK = 20000;
+    static const int CHECKPOINT_MS = 60000;
+    static constexpr double RECONNECT_BASE = 0.5;
+    static constexpr double RECONNECT_MAX = 30;
+
     Ui::MainMenu *ui;
+    TopicModel *model;
+    // repaints the visible rows so their rollups follow the traffic
+    QTimer *refresh;
+    TopTalkers talkers;
+    // newest message per topic as delivered, ahead of whatever is still queued
+    ConcurrentTopicTrie live;
+    // only used by the batch handler, which runs one batch at a time
+    TopicAliases aliases{live};
+    std::vector<mqtt::const_message_ptr> resolved;
+    SubscriptionManager subscriptions;
+    mqtt::async_client *client = nullptr;
+    mqtt::connect_options reconnect_options;
+    Backoff backoff{RECONNECT_BASE, RECONNECT_MAX};
+    bool reconnecting = false;
+    RetainedResync resync;
+    // retained topics the last resync did not hear of again
+    std::size_t stale_topics = 0;
+    RetainedClear clearing;
+    // deletes outstanding at a time, as last chosen
+    int clear_window = 256;
+    // bumped per connection, aliases are reset when the batch handler notices
+    std::atomic<unsigned> connection{0};
+    unsigned aliases_connection = 0;
+    IngestQueue ingest;
+    QTimer *ingest_timer;
+    std::vector<LastValueCache::Update> drained;
+    InitialSync sync;
+    std::atomic<bool> synced{false};
+    // written from the paho thread while recording
+    std::mutex capture_lock;
+    std::unique_ptr<CaptureWriter> capture;
+    std::chrono::steady_clock::time_point started;
+    // numeric history of the topics that were asked to be plotted
+    std::unordered_map<std::string, SeriesPyramid> series;
+    std::string plotted;
+
+    std::string selected_topic;
+    mqtt::const_message_ptr selected_before;
+    mqtt::const_message_ptr selected_after;
+    // diffs by the newer message; at most one computed at a time, newest request wins
+    std::unordered_map<const mqtt::message *, DiffEntry> diffs;
+    // pool tasks not known to be finished, waited for on destruction
+    std::vector<std::future<void>> background;
+    // set on destruction, stops a running export or import
+    std::atomic<bool> cancelled{false};
+    QTimer *checkpoint_timer;
+    std::string snapshot_path;
+    // until the restored tree is adopted, which may be after the load finished
+    bool restoring = false;
+    // until the first connect is accepted; the tree is shown meanwhile
+    bool connecting = true;
+    // accepted while restoring, subscribed once the restored tree is adopted
+    bool deferred_connect = false;
+    bool deferred_session = false;
+    // the next save rewrites the file, e.g. once node ids no longer match it
+    bool snapshot_full = true;
+    std::size_t snapshot_bytes = 0;
+    std::size_t checkpoint_bytes = 0;
+    DiffEntry diff_running;
+    DiffEntry diff_pending;
+
+    // last member: stops delivering before anything it feeds goes away
+    BatchCallback batches;
 };
 
 #endif // MAINMENU_H
@@ -1,6 +1,9 @@
 #include "mainwindow.h"
 #include <string>
 #include <QApplication>
+#include <QTimer>
+#include <iostream>
+#include "startup.h"
 
 //const std::string ADDRESS	{ "tcp://localhost:7412" };
 //const std::string CLIENT_ID		{ "test_client" };
@@ -67,8 +70,17 @@ int main(int argc, char *argv[])
     //return 0;
 
     // TODO incorporate the mechanismus above the GUI app
+    startup_mark("main");
     QApplication a(argc, argv);
+    startup_mark("QApplication");
     MainWindow w;
+    startup_mark("MainWindow");
     w.show();
+    // runs once the event loop is up, right after the first paint is queued
+    QTimer::singleShot(0, [] {
+        const double ms = startup_mark("window shown");
+        if (ms > STARTUP_BUDGET_MS)
+            std::cerr << "startup: over the " << STARTUP_BUDGET_MS << " ms budget" << std::endl;
+    });
     return a.exec();
 }
@@ -2,8 +2,11 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <memory>
+#include <string>
 #include "mainmenu.h"
 #include "client.h"
+#include "tokenawait.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -21,7 +24,13 @@ private slots:
     void on_connectBroker_clicked();
 
 private:
+    // back to the form if the broker did not accept
+    Detached connect_broker(std::string host, mqtt::connect_options options);
+    // per broker address, under the application data directory
+    static std::string snapshot_path(const std::string &address);
+
     Ui::MainWindow *ui;
-    MainMenu *main_menu;
+    MainMenu *main_menu = nullptr;
+    std::unique_ptr<mqtt::async_client> client;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,199 @@
+#include "messagediff.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <algorithm>
+
+namespace {
+
+// equal bytes shorter than this do not split a changed range
+const std::size_t RANGE_GAP = 8;
+const int VALUE_PREVIEW = 80;
+
+QString preview(const QJsonValue &value)
+{
+    QString text;
+    switch (value.type()) {
+    case QJsonValue::Object:
+        text = QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+        break;
+    case QJsonValue::Array:
+        text = QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+        break;
+    case QJsonValue::String:
+        text = '"' + value.toString() + '"';
+        break;
+    case QJsonValue::Double:
+        text = QString::number(value.toDouble());
+        break;
+    case QJsonValue::Bool:
+        text = value.toBool() ? "true" : "false";
+        break;
+    default:
+        text = "null";
+    }
+    if (text.size() > VALUE_PREVIEW)
+        text = text.left(VALUE_PREVIEW) + "...";
+    return text;
+}
+
+class JsonDiffer
+{
+public:
+    explicit JsonDiffer(MessageDiff &diff): diff(diff) {}
+
+    void walk(const QString &path, const QJsonValue &a, const QJsonValue &b)
+    {
+        if (full())
+            return;
+        if (a.type() != b.type()) {
+            add(MessageDiff::Kind::Changed, path, preview(a), preview(b));
+        } else if (a.isObject()) {
+            walk_object(path, a.toObject(), b.toObject());
+        } else if (a.isArray()) {
+            walk_array(path, a.toArray(), b.toArray());
+        } else if (a != b) {
+            add(MessageDiff::Kind::Changed, path, preview(a), preview(b));
+        }
+    }
+
+    void walk_object(const QString &path, const QJsonObject &a, const QJsonObject &b)
+    {
+        auto i = a.begin(), j = b.begin();
+        while (!full() && (i != a.end() || j != b.end())) {
+            if (j == b.end() || (i != a.end() && i.key() < j.key())) {
+                add(MessageDiff::Kind::Removed, child(path, i.key()), preview(i.value()), QString());
+                ++i;
+            } else if (i == a.end() || j.key() < i.key()) {
+                add(MessageDiff::Kind::Added, child(path, j.key()), QString(), preview(j.value()));
+                ++j;
+            } else {
+                walk(child(path, i.key()), i.value(), j.value());
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    void walk_array(const QString &path, const QJsonArray &a, const QJsonArray &b)
+    {
+        const int common = std::min(a.size(), b.size());
+        for (int k = 0; k < common && !full(); ++k)
+            walk(path + '[' + QString::number(k) + ']', a[k], b[k]);
+        for (int k = common; k < a.size() && !full(); ++k)
+            add(MessageDiff::Kind::Removed, path + '[' + QString::number(k) + ']', preview(a[k]), QString());
+        for (int k = common; k < b.size() && !full(); ++k)
+            add(MessageDiff::Kind::Added, path + '[' + QString::number(k) + ']', QString(), preview(b[k]));
+    }
+
+private:
+    static QString child(const QString &path, const QString &key)
+    {
+        return path.isEmpty() ? key : path + '.' + key;
+    }
+
+    bool full() const { return diff.truncated; }
+
+    void add(MessageDiff::Kind kind, const QString &path, const QString &before, const QString &after)
+    {
+        if (diff.changes.size() >= MessageDiff::MAX_ENTRIES) {
+            diff.truncated = true;
+            return;
+        }
+        diff.changes.push_back({kind, path, before, after});
+    }
+
+    MessageDiff &diff;
+};
+
+void diff_bytes(MessageDiff &diff, const std::string &a, const std::string &b)
+{
+    const std::size_t common = std::min(a.size(), b.size());
+    std::size_t i = 0;
+    while (i < common) {
+        if (a[i] == b[i]) {
+            ++i;
+            continue;
+        }
+        std::size_t end = i + 1;
+        std::size_t same = 0;
+        while (end < common && same < RANGE_GAP) {
+            same = a[end] == b[end] ? same + 1 : 0;
+            ++end;
+        }
+        end -= same;
+        if (diff.ranges.size() >= MessageDiff::MAX_ENTRIES) {
+            diff.truncated = true;
+            return;
+        }
+        diff.ranges.emplace_back(i, end);
+        i = end;
+    }
+    if (a.size() != b.size()) {
+        if (!diff.ranges.empty() && diff.ranges.back().second == common)
+            diff.ranges.back().second = std::max(a.size(), b.size());
+        else
+            diff.ranges.emplace_back(common, std::max(a.size(), b.size()));
+    }
+}
+
+} // namespace
+
+MessageDiff MessageDiff::compute(const std::string &before, const std::string &after)
+{
+    MessageDiff diff;
+    diff.before_size = before.size();
+    diff.after_size = after.size();
+
+    QJsonParseError error_a, error_b;
+    const QJsonDocument a = QJsonDocument::fromJson(
+                QByteArray::fromRawData(before.data(), static_cast<int>(before.size())), &error_a);
+    if (error_a.error == QJsonParseError::NoError) {
+        const QJsonDocument b = QJsonDocument::fromJson(
+                    QByteArray::fromRawData(after.data(), static_cast<int>(after.size())), &error_b);
+        if (error_b.error == QJsonParseError::NoError) {
+            diff.json = true;
+            JsonDiffer differ(diff);
+            const QJsonValue va = a.isObject() ? QJsonValue(a.object()) : QJsonValue(a.array());
+            const QJsonValue vb = b.isObject() ? QJsonValue(b.object()) : QJsonValue(b.array());
+            differ.walk(QString(), va, vb);
+            return diff;
+        }
+    }
+
+    diff_bytes(diff, before, after);
+    return diff;
+}
+
+QString MessageDiff::to_text() const
+{
+    QString text;
+    if (json) {
+        for (const Change &c : changes) {
+            switch (c.kind) {
+            case Kind::Added:
+                text += "+ " + c.path + ": " + c.after + '\n';
+                break;
+            case Kind::Removed:
+                text += "- " + c.path + ": " + c.before + '\n';
+                break;
+            case Kind::Changed:
+                text += "~ " + c.path + ": " + c.before + " -> " + c.after + '\n';
+                break;
+            }
+        }
+        if (changes.empty())
+            text = "no changes\n";
+    } else {
+        if (before_size != after_size)
+            text += QString("size %1 -> %2 bytes\n").arg(before_size).arg(after_size);
+        for (const auto &r : ranges)
+            text += QString("bytes %1..%2 changed\n").arg(r.first).arg(r.second);
+        if (ranges.empty())
+            text = "no changes\n";
+    }
+    if (truncated)
+        text += QString("... more than %1 differences\n").arg(MAX_ENTRIES);
+    return text;
+}
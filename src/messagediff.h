@@ -0,0 +1,44 @@
+#ifndef MESSAGEDIFF_H
+#define MESSAGEDIFF_H
+
+#include <QString>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Difference between two consecutive payloads of a topic.
+ *
+ * JSON documents are compared structurally: objects key by key (Qt keeps
+ * keys sorted, so this is a linear merge) and arrays index by index. Any
+ * other payload is compared byte-wise and reported as changed ranges.
+ * Both walks are linear in the payload size.
+ */
+struct MessageDiff
+{
+    enum class Kind { Added, Removed, Changed };
+
+    struct Change
+    {
+        Kind kind;
+        QString path;
+        QString before;
+        QString after;
+    };
+
+    static constexpr std::size_t MAX_ENTRIES = 1000;
+
+    static MessageDiff compute(const std::string &before, const std::string &after);
+    QString to_text() const;
+
+    bool json = false;
+    // more than MAX_ENTRIES differences, the rest is not listed
+    bool truncated = false;
+    std::vector<Change> changes;
+    // [begin, end) byte ranges of the new payload that differ
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    std::size_t before_size = 0;
+    std::size_t after_size = 0;
+};
+
+#endif // MESSAGEDIFF_H
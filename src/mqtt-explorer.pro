@@ -2,7 +2,10 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++17
+# coroutines (tokenawait.h); c++2a is the name both Qt 5 and Qt 6 qmake know,
+# GCC 10 still wants them switched on explicitly
+CONFIG += c++2a
+*-g++*: QMAKE_CXXFLAGS += -fcoroutines
 #CONFIG-=debug_and_release
 
 # You can make your code fail to compile if it uses deprecated APIs.
@@ -10,8 +13,11 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 INCLUDEPATH = ./mqtt_paho/libs/
-INCLUDEPATH += ./mqtt_paho/headers/
 INCLUDEPATH += .
+# as system headers: under C++20 paho's [=] lambdas capturing this would
+# otherwise warn (-Wdeprecated) in every file that includes them
+*-g++*|*clang*: QMAKE_CXXFLAGS += -isystem $$PWD/mqtt_paho/headers
+else: INCLUDEPATH += ./mqtt_paho/headers/
 LIBS = -fPIC -lpaho-mqttpp3 -lpaho-mqtt3a -lpaho-mqtt3as -lpaho-mqtt3c -lpaho-mqtt3cs
 
 DESTDIR=bin/ #Target file directory
@@ -19,13 +25,67 @@ OBJECTS_DIR=build/ #Intermediate object files directory
 MOC_DIR=build/
 
 SOURCES += \
+    backoff.cpp \
+    batchcallback.cpp \
+    capture.cpp \
+    concurrenttrie.cpp \
+    exporter.cpp \
+    importer.cpp \
+    ingestqueue.cpp \
+    initialsync.cpp \
+    lastvaluecache.cpp \
     main.cpp \
     mainmenu.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    messagediff.cpp \
+    mqttpacket.cpp \
+    payloadview.cpp \
+    plotwidget.cpp \
+    resync.cpp \
+    retainedclear.cpp \
+    seriespyramid.cpp \
+    snapshot.cpp \
+    startup.cpp \
+    subscriptions.cpp \
+    taskpool.cpp \
+    timingwheel.cpp \
+    tokenawait.cpp \
+    topicalias.cpp \
+    topicmodel.cpp \
+    topicstats.cpp \
+    topictree.cpp \
+    toptalkers.cpp
 
 HEADERS += \
+    backoff.h \
+    batchcallback.h \
+    capture.h \
+    concurrenttrie.h \
+    exporter.h \
+    importer.h \
+    ingestqueue.h \
+    initialsync.h \
+    lastvaluecache.h \
     mainmenu.h \
-    mainwindow.h
+    mainwindow.h \
+    messagediff.h \
+    mqttpacket.h \
+    payloadview.h \
+    plotwidget.h \
+    resync.h \
+    retainedclear.h \
+    seriespyramid.h \
+    snapshot.h \
+    startup.h \
+    subscriptions.h \
+    taskpool.h \
+    timingwheel.h \
+    tokenawait.h \
+    topicalias.h \
+    topicmodel.h \
+    topicstats.h \
+    topictree.h \
+    toptalkers.h
 
 FORMS += \
     ui/mainmenu.ui \
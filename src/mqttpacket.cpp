@@ -0,0 +1,255 @@
+#include "mqttpacket.h"
+#include <cstring>
+
+namespace {
+
+bool read_u16(const char *&p, const char *end, std::uint16_t &value)
+{
+    if (end - p < 2)
+        return false;
+    value = static_cast<std::uint16_t>((static_cast<unsigned char>(p[0]) << 8) | static_cast<unsigned char>(p[1]));
+    p += 2;
+    return true;
+}
+
+bool read_string(const char *&p, const char *end, std::string &value)
+{
+    std::uint16_t n;
+    if (!read_u16(p, end, n) || end - p < n)
+        return false;
+    value.assign(p, n);
+    p += n;
+    return true;
+}
+
+// walks MQTT 5 properties, picking out the topic alias
+bool read_properties(const char *&p, const char *end, std::uint16_t &topic_alias)
+{
+    std::uint32_t length;
+    if (!read_varint(p, end, length) || end - p < static_cast<std::ptrdiff_t>(length))
+        return false;
+    const char *stop = p + length;
+    while (p < stop) {
+        std::uint32_t id;
+        if (!read_varint(p, stop, id))
+            return false;
+        std::uint32_t skip = 0;
+        switch (id) {
+        case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2a:
+            skip = 1;
+            break;
+        case 0x23:
+            if (!read_u16(p, stop, topic_alias))
+                return false;
+            break;
+        case 0x13: case 0x21: case 0x22:
+            skip = 2;
+            break;
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            skip = 4;
+            break;
+        case 0x0b: {
+            std::uint32_t ignored;
+            if (!read_varint(p, stop, ignored))
+                return false;
+            break;
+        }
+        case 0x26: {
+            std::string key, value;
+            if (!read_string(p, stop, key) || !read_string(p, stop, value))
+                return false;
+            break;
+        }
+        case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1a: case 0x1c: case 0x1f: {
+            std::string ignored;
+            if (!read_string(p, stop, ignored))
+                return false;
+            break;
+        }
+        default:
+            return false;
+        }
+        if (stop - p < static_cast<std::ptrdiff_t>(skip))
+            return false;
+        p += skip;
+    }
+    return true;
+}
+
+void write_u16(std::string &out, std::uint16_t value)
+{
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value & 0xff);
+}
+
+void write_string(std::string &out, const std::string &value)
+{
+    write_u16(out, static_cast<std::uint16_t>(value.size()));
+    out += value;
+}
+
+} // namespace
+
+bool read_varint(const char *&p, const char *end, std::uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 28; shift += 7) {
+        if (p == end)
+            return false;
+        const unsigned char b = static_cast<unsigned char>(*p++);
+        value |= std::uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void write_varint(std::string &out, std::uint32_t value)
+{
+    do {
+        const char b = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        out += value ? static_cast<char>(b | 0x80) : b;
+    } while (value);
+}
+
+void MqttStreamParser::feed(const char *data, std::size_t size)
+{
+    if (failed)
+        return;
+    // drop what was consumed before the buffer grows again
+    if (offset > 0 && offset >= buffer.size() / 2) {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+    buffer.append(data, size);
+}
+
+bool MqttStreamParser::next(MqttPacket &packet)
+{
+    if (failed || buffer.size() - offset < 2)
+        return false;
+
+    const char *begin = buffer.data() + offset;
+    const char *end = buffer.data() + buffer.size();
+    const unsigned char header = static_cast<unsigned char>(*begin);
+    const char *p = begin + 1;
+    std::uint32_t length;
+    if (!read_varint(p, end, length)) {
+        // four length bytes with the continuation bit can never become valid
+        if (end - begin >= 5)
+            failed = true;
+        return false;
+    }
+    if ((header >> 4) == 0) {
+        failed = true;
+        return false;
+    }
+    if (static_cast<std::size_t>(end - p) < length)
+        return false;
+
+    packet.type = static_cast<MqttPacketType>(header >> 4);
+    packet.flags = header & 0x0f;
+    packet.body.assign(p, length);
+    offset = (p - buffer.data()) + length;
+    return true;
+}
+
+void MqttStreamParser::reset()
+{
+    buffer.clear();
+    offset = 0;
+    failed = false;
+}
+
+bool parse_publish(const MqttPacket &packet, int version, MqttPublish &publish)
+{
+    if (packet.type != MqttPacketType::Publish)
+        return false;
+    publish.dup = packet.flags & 0x08;
+    publish.qos = (packet.flags >> 1) & 3;
+    publish.retained = packet.flags & 1;
+    publish.packet_id = 0;
+    publish.topic_alias = 0;
+    if (publish.qos == 3)
+        return false;
+
+    const char *p = packet.body.data();
+    const char *end = p + packet.body.size();
+    if (!read_string(p, end, publish.topic))
+        return false;
+    if (publish.qos > 0 && !read_u16(p, end, publish.packet_id))
+        return false;
+    if (version >= 5 && !read_properties(p, end, publish.topic_alias))
+        return false;
+    publish.payload.assign(p, end);
+    return true;
+}
+
+int parse_connect_version(const MqttPacket &packet)
+{
+    if (packet.type != MqttPacketType::Connect)
+        return 0;
+    const char *p = packet.body.data();
+    const char *end = p + packet.body.size();
+    std::string protocol;
+    if (!read_string(p, end, protocol) || p == end)
+        return 0;
+    if (protocol != "MQTT" && protocol != "MQIsdp")
+        return 0;
+    return static_cast<unsigned char>(*p);
+}
+
+bool parse_subscribe(const MqttPacket &packet, int version, std::uint16_t &packet_id, std::vector<std::string> &filters)
+{
+    const bool subscribe = packet.type == MqttPacketType::Subscribe;
+    if (!subscribe && packet.type != MqttPacketType::Unsubscribe)
+        return false;
+    const char *p = packet.body.data();
+    const char *end = p + packet.body.size();
+    std::uint16_t ignored_alias;
+    if (!read_u16(p, end, packet_id) || (version >= 5 && !read_properties(p, end, ignored_alias)))
+        return false;
+    filters.clear();
+    while (p < end) {
+        std::string filter;
+        if (!read_string(p, end, filter))
+            return false;
+        // subscription options, only SUBSCRIBE has them
+        if (subscribe && p++ == end)
+            return false;
+        filters.push_back(std::move(filter));
+    }
+    return !filters.empty();
+}
+
+std::string encode_packet(MqttPacketType type, std::uint8_t flags, const std::string &body)
+{
+    std::string packet;
+    packet.reserve(body.size() + 5);
+    packet += static_cast<char>(static_cast<std::uint8_t>(type) << 4 | (flags & 0x0f));
+    write_varint(packet, static_cast<std::uint32_t>(body.size()));
+    packet += body;
+    return packet;
+}
+
+std::string encode_publish(const MqttPublish &publish, int version)
+{
+    std::string body;
+    body.reserve(publish.topic.size() + publish.payload.size() + 8);
+    write_string(body, publish.topic);
+    if (publish.qos > 0)
+        write_u16(body, publish.packet_id);
+    if (version >= 5) {
+        if (publish.topic_alias) {
+            body += '\x03';
+            body += '\x23';
+            write_u16(body, publish.topic_alias);
+        } else {
+            body += '\x00';
+        }
+    }
+    body += publish.payload;
+    const std::uint8_t flags = (publish.dup ? 0x08 : 0) | (publish.qos & 3) << 1 | (publish.retained ? 1 : 0);
+    return encode_packet(MqttPacketType::Publish, flags, body);
+}
@@ -0,0 +1,72 @@
+#ifndef MQTTPACKET_H
+#define MQTTPACKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// control packet types of MQTT 3.1.1 and 5
+enum class MqttPacketType : std::uint8_t {
+    Connect = 1, Connack, Publish, Puback, Pubrec, Pubrel, Pubcomp,
+    Subscribe, Suback, Unsubscribe, Unsuback, Pingreq, Pingresp, Disconnect, Auth
+};
+
+struct MqttPacket
+{
+    MqttPacketType type;
+    // low nibble of the fixed header
+    std::uint8_t flags;
+    std::string body;
+};
+
+/**
+ * Splits one direction of an MQTT byte stream into control packets.
+ *
+ * Bytes may arrive in arbitrary pieces, e.g. TCP segments; a packet is
+ * returned once it is complete. A fixed header that cannot be MQTT puts
+ * the parser into the broken state, where it ignores all further input.
+ */
+class MqttStreamParser
+{
+public:
+    void feed(const char *data, std::size_t size);
+    bool next(MqttPacket &packet);
+    bool broken() const { return failed; }
+    void reset();
+
+private:
+    std::string buffer;
+    std::size_t offset = 0;
+    bool failed = false;
+};
+
+struct MqttPublish
+{
+    std::string topic;
+    std::string payload;
+    int qos = 0;
+    bool retained = false;
+    bool dup = false;
+    std::uint16_t packet_id = 0;
+    // MQTT 5 topic alias, 0 when absent
+    std::uint16_t topic_alias = 0;
+};
+
+// decodes a PUBLISH for protocol level `version` (4 = 3.1.1, 5 = 5.0)
+bool parse_publish(const MqttPacket &packet, int version, MqttPublish &publish);
+// protocol level announced by a CONNECT, 0 if the packet is not a valid CONNECT
+int parse_connect_version(const MqttPacket &packet);
+
+// packet id and topic filters of a SUBSCRIBE or UNSUBSCRIBE
+bool parse_subscribe(const MqttPacket &packet, int version, std::uint16_t &packet_id, std::vector<std::string> &filters);
+
+// variable byte integer as used for lengths; false if truncated or longer than 4 bytes
+bool read_varint(const char *&p, const char *end, std::uint32_t &value);
+void write_varint(std::string &out, std::uint32_t value);
+
+// fixed header followed by the body
+std::string encode_packet(MqttPacketType type, std::uint8_t flags, const std::string &body);
+std::string encode_publish(const MqttPublish &publish, int version);
+
+#endif // MQTTPACKET_H
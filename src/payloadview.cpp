@@ -0,0 +1,161 @@
+#include "payloadview.h"
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// payloads with control characters in their first bytes are shown as hex
+bool looks_binary(const char *data, std::size_t size)
+{
+    const std::size_t n = std::min<std::size_t>(size, 4096);
+    std::size_t control = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c < 0x09 || (c > 0x0d && c < 0x20))
+            ++control;
+    }
+    return control * 100 > n;
+}
+
+} // namespace
+
+PayloadView::PayloadView(QWidget *parent):
+    QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    clear();
+}
+
+void PayloadView::set_payload(const mqtt::binary_ref &payload, bool keep_position)
+{
+    const int top = keep_position ? verticalScrollBar()->value() : 0;
+    const int left = keep_position ? horizontalScrollBar()->value() : 0;
+    this->payload = payload;
+    hex = mode == Mode::Hex || looks_binary(payload ? payload.data() : nullptr, size());
+    line_starts.assign(1, 0);
+    scanned = 0;
+    // the lines are only measured once painted, so the old width keeps the column
+    if (!keep_position)
+        widest = 0;
+    update_scrollbars();
+    // clamped to the new ranges
+    verticalScrollBar()->setValue(top);
+    horizontalScrollBar()->setValue(left);
+    viewport()->update();
+}
+
+void PayloadView::set_mode(Mode mode)
+{
+    this->mode = mode;
+    set_payload(mqtt::binary_ref(payload));
+}
+
+void PayloadView::clear()
+{
+    set_payload(mqtt::binary_ref());
+}
+
+std::size_t PayloadView::size() const
+{
+    return payload ? payload.size() : 0;
+}
+
+std::size_t PayloadView::line_count() const
+{
+    if (hex)
+        return (size() + HEX_BYTES - 1) / HEX_BYTES;
+    if (scanned >= size())
+        return line_starts.back() == size() && size() > 0 ? line_starts.size() - 1 : line_starts.size();
+    // not indexed to the end yet, extrapolate from what was seen so far
+    return std::max<std::size_t>(line_starts.size(),
+                                 static_cast<std::size_t>(double(line_starts.size()) * size() / std::max<std::size_t>(scanned, 1)));
+}
+
+void PayloadView::index_to(std::size_t line)
+{
+    const char *data = payload ? payload.data() : nullptr;
+    while (line_starts.size() <= line + 1 && scanned < size()) {
+        const void *nl = std::memchr(data + scanned, '\n', size() - scanned);
+        const std::size_t end = nl ? static_cast<const char *>(nl) - data : size();
+        widest = std::max(widest, std::min(end - line_starts.back(), MAX_LINE));
+        scanned = nl ? end + 1 : size();
+        if (nl)
+            line_starts.push_back(scanned);
+    }
+}
+
+QString PayloadView::line_text(std::size_t line) const
+{
+    const char *data = payload.data();
+    if (hex) {
+        const std::size_t begin = line * HEX_BYTES;
+        const std::size_t end = std::min(begin + HEX_BYTES, size());
+        QString text = QString("%1  ").arg(begin, 8, 16, QChar('0'));
+        for (std::size_t i = begin; i < begin + HEX_BYTES; ++i) {
+            if (i < end)
+                text += QString("%1 ").arg(static_cast<uint>(static_cast<unsigned char>(data[i])), 2, 16, QChar('0'));
+            else
+                text += "   ";
+        }
+        text += ' ';
+        for (std::size_t i = begin; i < end; ++i) {
+            const char c = data[i];
+            text += c >= 0x20 && c < 0x7f ? QChar(c) : QChar('.');
+        }
+        return text;
+    }
+
+    const std::size_t begin = line_starts[line];
+    std::size_t end = line + 1 < line_starts.size() ? line_starts[line + 1] - 1 : size();
+    if (end > begin && data[end - 1] == '\r')
+        --end;
+    return QString::fromUtf8(data + begin, static_cast<int>(std::min(end - begin, MAX_LINE)));
+}
+
+void PayloadView::update_scrollbars()
+{
+    const QFontMetrics metrics(font());
+    const int rows = std::max(viewport()->height() / metrics.lineSpacing(), 1);
+    const int columns = std::max(viewport()->width() / std::max(metrics.averageCharWidth(), 1), 1);
+    const std::size_t width = hex ? 10 + 4 * HEX_BYTES : widest;
+
+    verticalScrollBar()->setPageStep(rows);
+    verticalScrollBar()->setRange(0, static_cast<int>(std::max<std::size_t>(line_count(), rows) - rows));
+    horizontalScrollBar()->setPageStep(columns);
+    horizontalScrollBar()->setRange(0, static_cast<int>(std::max<std::size_t>(width, columns) - columns));
+}
+
+void PayloadView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), palette().base());
+    if (size() == 0)
+        return;
+
+    const QFontMetrics metrics(font());
+    const int height = metrics.lineSpacing();
+    const std::size_t first = static_cast<std::size_t>(verticalScrollBar()->value());
+    const std::size_t rows = static_cast<std::size_t>(viewport()->height() / height + 1);
+    const int x = 2 - horizontalScrollBar()->value() * metrics.averageCharWidth();
+
+    if (!hex)
+        index_to(first + rows);
+    const std::size_t known = line_count();
+    painter.setPen(palette().color(QPalette::Text));
+    for (std::size_t line = first; line < first + rows && line < known; ++line) {
+        if (!hex && line >= line_starts.size())
+            break;
+        painter.drawText(x, static_cast<int>(line - first) * height + metrics.ascent(), line_text(line));
+    }
+    if (!hex)
+        update_scrollbars();
+}
+
+void PayloadView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    update_scrollbars();
+}
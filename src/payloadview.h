@@ -0,0 +1,56 @@
+#ifndef PAYLOADVIEW_H
+#define PAYLOADVIEW_H
+
+#include <QAbstractScrollArea>
+#include <mqtt/buffer_ref.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Read-only view of a message payload of any size.
+ *
+ * Shares the payload buffer of the message instead of copying it and
+ * only formats the lines inside the viewport. Hex lines are computed from
+ * their offset; text lines are found with memchr, only as far down as
+ * the view has been scrolled, so opening a 100 MB payload costs nothing.
+ */
+class PayloadView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    // Auto shows payloads that look binary as hex
+    enum class Mode { Auto, Hex };
+
+    explicit PayloadView(QWidget *parent = nullptr);
+
+    // keep_position for a newer payload of the same topic, which stays scrolled where it was
+    void set_payload(const mqtt::binary_ref &payload, bool keep_position = false);
+    void set_mode(Mode mode);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    static const std::size_t HEX_BYTES = 16;
+    // longer text lines are cut, nobody reads further sideways
+    static const std::size_t MAX_LINE = 4096;
+
+    std::size_t size() const;
+    std::size_t line_count() const;
+    void index_to(std::size_t line);
+    QString line_text(std::size_t line) const;
+    void update_scrollbars();
+
+    mqtt::binary_ref payload;
+    Mode mode = Mode::Auto;
+    bool hex = false;
+    // start offsets of the text lines found so far
+    std::vector<std::size_t> line_starts;
+    std::size_t scanned = 0;
+    std::size_t widest = 0;
+};
+
+#endif // PAYLOADVIEW_H
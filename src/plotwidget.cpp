@@ -0,0 +1,115 @@
+#include "plotwidget.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+
+PlotWidget::PlotWidget(QWidget *parent):
+    QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void PlotWidget::set_series(const SeriesPyramid *series)
+{
+    this->series = series;
+    follow = true;
+    update();
+}
+
+void PlotWidget::set_mode(Mode mode)
+{
+    this->mode = mode;
+    update();
+}
+
+void PlotWidget::series_changed()
+{
+    // nothing new to draw while the user looks at an older window
+    if (follow)
+        update();
+}
+
+void PlotWidget::visible_window(double &t0, double &t1) const
+{
+    if (follow) {
+        t0 = series->first_time();
+        t1 = series->last_time();
+    } else {
+        t0 = view_t0;
+        t1 = view_t1;
+    }
+}
+
+void PlotWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    if (!series || series->empty())
+        return;
+
+    double t0, t1;
+    visible_window(t0, t1);
+    const std::size_t pixels = static_cast<std::size_t>(std::max(width(), 1));
+    const std::vector<SamplePoint> points = mode == Mode::Lttb
+            ? series->lttb(t0, t1, pixels)
+            : series->min_max(t0, t1, pixels);
+    if (points.empty())
+        return;
+
+    double lo = points.front().v, hi = points.front().v;
+    for (const SamplePoint &p : points) {
+        lo = std::min(lo, p.v);
+        hi = std::max(hi, p.v);
+    }
+    if (hi == lo) {
+        lo -= 1;
+        hi += 1;
+    }
+    const double dt = t1 > t0 ? t1 - t0 : 1;
+    const double w = width() - 1, h = height() - 1;
+
+    QPainterPath path;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        const QPointF p((points[i].t - t0) / dt * w, h - (points[i].v - lo) / (hi - lo) * h);
+        if (i == 0)
+            path.moveTo(p);
+        else
+            path.lineTo(p);
+    }
+    painter.setPen(palette().color(QPalette::Highlight));
+    painter.drawPath(path);
+
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignTop | Qt::AlignLeft, QString::number(hi));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignBottom | Qt::AlignLeft, QString::number(lo));
+}
+
+void PlotWidget::wheelEvent(QWheelEvent *event)
+{
+    if (!series || series->empty())
+        return;
+
+    double t0, t1;
+    visible_window(t0, t1);
+    const double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const double x = event->position().x();
+#else
+    const double x = event->posF().x();
+#endif
+    const double anchor = t0 + (t1 - t0) * std::clamp(x / std::max(width(), 1), 0.0, 1.0);
+
+    view_t0 = std::max(anchor - (anchor - t0) * factor, series->first_time());
+    view_t1 = std::min(anchor + (t1 - anchor) * factor, series->last_time());
+    follow = view_t0 <= series->first_time() && view_t1 >= series->last_time();
+    update();
+    event->accept();
+}
+
+void PlotWidget::mouseDoubleClickEvent(QMouseEvent *)
+{
+    follow = true;
+    update();
+}
@@ -0,0 +1,43 @@
+#ifndef PLOTWIDGET_H
+#define PLOTWIDGET_H
+
+#include <QWidget>
+#include "seriespyramid.h"
+
+/**
+ * Line chart of a single SeriesPyramid.
+ *
+ * Only the downsampled view of the visible time window is drawn, so a
+ * repaint costs O(width) regardless of the number of stored samples.
+ * The mouse wheel zooms around the cursor, a double click returns to
+ * following the live end of the series.
+ */
+class PlotWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum class Mode { MinMax, Lttb };
+
+    explicit PlotWidget(QWidget *parent = nullptr);
+
+    void set_series(const SeriesPyramid *series);
+    void set_mode(Mode mode);
+    void series_changed();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    void visible_window(double &t0, double &t1) const;
+
+    const SeriesPyramid *series = nullptr;
+    Mode mode = Mode::MinMax;
+    bool follow = true;
+    double view_t0 = 0;
+    double view_t1 = 0;
+};
+
+#endif // PLOTWIDGET_H
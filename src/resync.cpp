@@ -0,0 +1,38 @@
+#include "resync.h"
+#include "topicstats.h"
+
+void RetainedResync::start()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    topics.clear();
+    count = 0;
+    last_retained = stats_clock();
+    running = true;
+}
+
+bool RetainedResync::replayed(const ConcurrentTopicTrie::Node *node, const mqtt::const_message_ptr &msg)
+{
+    if (!running || !msg->is_retained())
+        return false;
+    last_retained = stats_clock();
+    const mqtt::const_message_ptr current = std::atomic_load(&node->value);
+    if (!current || current->get_payload() != msg->get_payload())
+        return false;
+    std::lock_guard<std::mutex> guard(lock);
+    topics.push_back(msg->get_topic_ref());
+    ++count;
+    return true;
+}
+
+std::vector<mqtt::string_ref> RetainedResync::take_confirmed()
+{
+    std::vector<mqtt::string_ref> taken;
+    std::lock_guard<std::mutex> guard(lock);
+    taken.swap(topics);
+    return taken;
+}
+
+bool RetainedResync::quiet() const
+{
+    return running && stats_clock() - last_retained >= QUIET;
+}
@@ -0,0 +1,46 @@
+#ifndef RESYNC_H
+#define RESYNC_H
+
+#include <mqtt/message.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "concurrenttrie.h"
+
+/**
+ * Retained-message replay after reconnecting without a kept session.
+ *
+ * Resubscribing makes the broker replay its whole retained store, which
+ * mostly repeats what the tree already holds. While active, replayed()
+ * checks each retained message against the live trie before it is
+ * updated: an unchanged payload only confirms the topic, and the caller
+ * drops the message instead of queueing it like new traffic. Confirmed
+ * topics are collected for TopicTree::confirm(). As with InitialSync, the
+ * replay is over once no retained message arrived for QUIET seconds.
+ */
+class RetainedResync
+{
+public:
+    static constexpr double QUIET = 0.3;
+
+    void start();
+    void stop() { running = false; }
+    bool active() const { return running; }
+
+    // on the delivering thread, before node is updated with msg; true if it changes nothing
+    bool replayed(const ConcurrentTopicTrie::Node *node, const mqtt::const_message_ptr &msg);
+    // topics confirmed since the last call
+    std::vector<mqtt::string_ref> take_confirmed();
+    // active, and no retained message for QUIET seconds
+    bool quiet() const;
+    std::size_t confirmed() const { return count; }
+
+private:
+    std::mutex lock;
+    std::vector<mqtt::string_ref> topics;
+    std::atomic<bool> running{false};
+    std::atomic<double> last_retained{0};
+    std::atomic<std::size_t> count{0};
+};
+
+#endif // RESYNC_H
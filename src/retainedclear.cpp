@@ -0,0 +1,165 @@
+#include "retainedclear.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+/*
+ * One clear. Paho keeps a plain reference to the listener, so the run
+ * keeps itself alive while any delete is outstanding.
+ */
+class RetainedClear::Run : public mqtt::iaction_listener
+{
+public:
+    // cleared: topics of an earlier run nobody took yet
+    Run(mqtt::async_client &client, std::vector<std::string> topics, std::size_t window,
+        std::vector<std::string> cleared):
+        client(client),
+        topics(std::move(topics)),
+        window(std::max<std::size_t>(window, 1)),
+        started(std::chrono::steady_clock::now()),
+        cleared(std::move(cleared)) {}
+
+    void issue(const std::shared_ptr<Run> &self);
+    void stop();
+    Progress progress() const;
+    std::vector<std::string> take_cleared();
+
+    void on_success(const mqtt::token &token) override { done(token, false); }
+    void on_failure(const mqtt::token &token) override { done(token, true); }
+
+private:
+    void done(const mqtt::token &token, bool failed);
+    // under the lock
+    void finish();
+
+    mqtt::async_client &client;
+    const std::vector<std::string> topics;
+    const std::size_t window;
+    const std::chrono::steady_clock::time_point started;
+
+    mutable std::mutex lock;
+    std::vector<std::string> cleared;
+    std::size_t next = 0;
+    std::size_t in_flight = 0;
+    std::size_t acknowledged = 0;
+    std::size_t failed = 0;
+    bool stopped = false;
+    std::chrono::steady_clock::time_point finished;
+    std::shared_ptr<Run> keep;
+};
+
+void RetainedClear::Run::issue(const std::shared_ptr<Run> &self)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopped && in_flight < window && next < topics.size()) {
+        const std::string &topic = topics[next++];
+        ++in_flight;
+        keep = self;
+        // paho is never called under the lock, its callbacks take it
+        guard.unlock();
+        try {
+            client.publish(topic, nullptr, 0, 1, true, nullptr, *this);
+        } catch (const mqtt::exception &exc) {
+            // done() is not coming for it
+            guard.lock();
+            --in_flight;
+            // paho's queue of unsent requests is full; the next acknowledgement retries
+            if (exc.get_return_code() == MQTTASYNC_MAX_BUFFERED_MESSAGES && in_flight > 0) {
+                --next;
+                break;
+            }
+            stopped = true;
+            break;
+        }
+        guard.lock();
+    }
+    finish();
+}
+
+void RetainedClear::Run::done(const mqtt::token &token, bool failure)
+{
+    // the listener of a publish is always handed its delivery token
+    const auto *delivery = dynamic_cast<const mqtt::delivery_token *>(&token);
+    const mqtt::const_message_ptr msg = delivery ? delivery->get_message() : nullptr;
+    std::shared_ptr<Run> self;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        --in_flight;
+        if (failure) {
+            ++failed;
+        } else {
+            ++acknowledged;
+            if (msg)
+                cleared.push_back(msg->get_topic());
+        }
+        self = keep;
+    }
+    if (self)
+        issue(self);
+}
+
+void RetainedClear::Run::finish()
+{
+    if (!stopped && next < topics.size())
+        return;
+    if (finished == std::chrono::steady_clock::time_point() && (stopped || in_flight == 0))
+        finished = std::chrono::steady_clock::now();
+    // paho may still report the outstanding ones; the caller holds a reference if this was the last
+    if (in_flight == 0)
+        keep.reset();
+}
+
+void RetainedClear::Run::stop()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stopped = true;
+    finish();
+}
+
+RetainedClear::Progress RetainedClear::Run::progress() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Progress p;
+    p.total = topics.size();
+    p.acknowledged = acknowledged;
+    p.failed = failed + (stopped ? topics.size() - next : 0);
+    // a stopped run is over, even if acknowledgements are still coming in
+    p.running = !stopped && (in_flight > 0 || next < topics.size());
+    const auto end = p.running ? std::chrono::steady_clock::now() : finished;
+    p.seconds = std::chrono::duration<double>(end - started).count();
+    return p;
+}
+
+std::vector<std::string> RetainedClear::Run::take_cleared()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return std::move(cleared);
+}
+
+RetainedClear::~RetainedClear()
+{
+    stop();
+}
+
+void RetainedClear::start(mqtt::async_client &client, std::vector<std::string> topics, std::size_t window)
+{
+    stop();
+    run = std::make_shared<Run>(client, std::move(topics), window, take_cleared());
+    run->issue(run);
+}
+
+void RetainedClear::stop()
+{
+    if (run)
+        run->stop();
+}
+
+RetainedClear::Progress RetainedClear::progress() const
+{
+    return run ? run->progress() : Progress();
+}
+
+std::vector<std::string> RetainedClear::take_cleared()
+{
+    return run ? run->take_cleared() : std::vector<std::string>();
+}
@@ -0,0 +1,52 @@
+#ifndef RETAINEDCLEAR_H
+#define RETAINEDCLEAR_H
+
+#include <mqtt/async_client.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Deletes retained messages: an empty retained message per topic.
+ *
+ * The deletes are QoS 1, so each one is acknowledged. Up to `window` are
+ * outstanding; the next is published from the paho thread as soon as one
+ * is acknowledged, so 200000 topics take about 200000 / window round
+ * trips rather than one each. When paho has too many requests not yet
+ * sent, the window shrinks to what it takes. Callable from any thread.
+ */
+class RetainedClear
+{
+public:
+    struct Progress
+    {
+        std::size_t total = 0;
+        std::size_t acknowledged = 0;
+        // refused by the broker, or not published at all once disconnected
+        std::size_t failed = 0;
+        double seconds = 0;
+        bool running = false;
+    };
+
+    RetainedClear() = default;
+    ~RetainedClear();
+    RetainedClear(const RetainedClear &) = delete;
+    RetainedClear &operator=(const RetainedClear &) = delete;
+
+    // stops any clear still running first
+    void start(mqtt::async_client &client, std::vector<std::string> topics, std::size_t window);
+    // publishes nothing more, the rest counts as failed; e.g. when the connection is lost
+    void stop();
+    Progress progress() const;
+    // topics whose delete was acknowledged since the last call; the broker
+    // forwards deletes with RETAIN=0, so the tree does not learn of them itself
+    std::vector<std::string> take_cleared();
+
+private:
+    class Run;
+
+    std::shared_ptr<Run> run;
+};
+
+#endif // RETAINEDCLEAR_H
@@ -0,0 +1,199 @@
+#include "seriespyramid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+SampleBucket bucket_of(const SamplePoint &p)
+{
+    return SampleBucket{p.t, p.t, p.t, p.v, p.t, p.v};
+}
+
+void merge(SampleBucket &into, const SampleBucket &b)
+{
+    into.t_last = b.t_last;
+    if (b.min < into.min) {
+        into.min = b.min;
+        into.t_min = b.t_min;
+    }
+    if (b.max > into.max) {
+        into.max = b.max;
+        into.t_max = b.t_max;
+    }
+}
+
+void emit(std::vector<SamplePoint> &out, const SampleBucket &b)
+{
+    if (b.t_min == b.t_max) {
+        out.push_back({b.t_min, b.min});
+    } else if (b.t_min < b.t_max) {
+        out.push_back({b.t_min, b.min});
+        out.push_back({b.t_max, b.max});
+    } else {
+        out.push_back({b.t_max, b.max});
+        out.push_back({b.t_min, b.min});
+    }
+}
+
+bool before(const SamplePoint &p, double t) { return p.t < t; }
+bool after(double t, const SamplePoint &p) { return t < p.t; }
+
+} // namespace
+
+SeriesPyramid::SeriesPyramid(std::size_t fanout):
+    fanout(std::max<std::size_t>(fanout, 2))
+{
+}
+
+void SeriesPyramid::append(double t, double v)
+{
+    const std::size_t index = raw.size();
+    raw.push_back({t, v});
+    const SampleBucket point = bucket_of(raw.back());
+
+    for (std::size_t k = 0; k < levels.size(); ++k) {
+        std::vector<SampleBucket> &level = levels[k];
+        if (index / spans[k] == level.size())
+            level.push_back(point);
+        else
+            merge(level.back(), point);
+    }
+
+    // grow a new, coarser level once the current top one has `fanout` full buckets
+    const std::size_t top = spans.empty() ? 1 : spans.back();
+    if (raw.size() >= top * fanout * fanout) {
+        std::vector<SampleBucket> level;
+        level.reserve(raw.size() / (top * fanout) + 1);
+        if (levels.empty()) {
+            for (std::size_t i = 0; i < raw.size(); ++i) {
+                if (i % fanout == 0)
+                    level.push_back(bucket_of(raw[i]));
+                else
+                    merge(level.back(), bucket_of(raw[i]));
+            }
+        } else {
+            const std::vector<SampleBucket> &below = levels.back();
+            for (std::size_t i = 0; i < below.size(); ++i) {
+                if (i % fanout == 0)
+                    level.push_back(below[i]);
+                else
+                    merge(level.back(), below[i]);
+            }
+        }
+        levels.push_back(std::move(level));
+        spans.push_back(top * fanout);
+    }
+}
+
+void SeriesPyramid::clear()
+{
+    raw.clear();
+    levels.clear();
+    spans.clear();
+}
+
+std::size_t SeriesPyramid::level_for(std::size_t count, std::size_t pixels) const
+{
+    std::size_t best = 0;
+    for (std::size_t k = 0; k < spans.size(); ++k) {
+        if (count / spans[k] >= 2 * pixels)
+            best = k + 1;
+    }
+    return best;
+}
+
+std::vector<SamplePoint> SeriesPyramid::min_max(double t0, double t1, std::size_t pixels) const
+{
+    std::vector<SamplePoint> out;
+    if (raw.empty() || pixels == 0 || t1 < t0)
+        return out;
+
+    const std::size_t lo = std::lower_bound(raw.begin(), raw.end(), t0, before) - raw.begin();
+    const std::size_t hi = std::upper_bound(raw.begin(), raw.end(), t1, after) - raw.begin();
+    if (hi <= lo)
+        return out;
+    if (hi - lo <= 2 * pixels)
+        return std::vector<SamplePoint>(raw.begin() + lo, raw.begin() + hi);
+
+    const double width = (t1 - t0) / pixels;
+    const std::size_t k = level_for(hi - lo, pixels);
+    out.reserve(2 * pixels);
+
+    long column = -1;
+    SampleBucket acc{};
+    auto add = [&](const SampleBucket &b) {
+        long c = width > 0 ? static_cast<long>((b.t_first - t0) / width) : 0;
+        c = std::clamp<long>(c, 0, static_cast<long>(pixels) - 1);
+        if (c != column) {
+            if (column >= 0)
+                emit(out, acc);
+            acc = b;
+            column = c;
+        } else {
+            merge(acc, b);
+        }
+    };
+
+    if (k == 0) {
+        for (std::size_t i = lo; i < hi; ++i)
+            add(bucket_of(raw[i]));
+    } else {
+        const std::vector<SampleBucket> &level = levels[k - 1];
+        const std::size_t last = std::min((hi - 1) / spans[k - 1], level.size() - 1);
+        for (std::size_t b = lo / spans[k - 1]; b <= last; ++b)
+            add(level[b]);
+    }
+    if (column >= 0)
+        emit(out, acc);
+    return out;
+}
+
+std::vector<SamplePoint> SeriesPyramid::lttb(double t0, double t1, std::size_t pixels) const
+{
+    // LTTB is linear in its input, so feed it the O(pixels) min/max envelope
+    return lttb(min_max(t0, t1, 2 * pixels), pixels);
+}
+
+std::vector<SamplePoint> SeriesPyramid::lttb(const std::vector<SamplePoint> &in, std::size_t threshold)
+{
+    const std::size_t n = in.size();
+    if (threshold >= n || threshold < 3)
+        return in;
+
+    std::vector<SamplePoint> out;
+    out.reserve(threshold);
+    out.push_back(in.front());
+
+    const double every = static_cast<double>(n - 2) / (threshold - 2);
+    std::size_t a = 0;
+    for (std::size_t i = 0; i < threshold - 2; ++i) {
+        std::size_t avg_start = static_cast<std::size_t>(std::floor((i + 1) * every)) + 1;
+        std::size_t avg_end = std::min(static_cast<std::size_t>(std::floor((i + 2) * every)) + 1, n);
+        double avg_t = 0, avg_v = 0;
+        for (std::size_t j = avg_start; j < avg_end; ++j) {
+            avg_t += in[j].t;
+            avg_v += in[j].v;
+        }
+        const double len = static_cast<double>(std::max<std::size_t>(avg_end - avg_start, 1));
+        avg_t /= len;
+        avg_v /= len;
+
+        const std::size_t from = static_cast<std::size_t>(std::floor(i * every)) + 1;
+        const std::size_t to = static_cast<std::size_t>(std::floor((i + 1) * every)) + 1;
+        double best_area = -1;
+        std::size_t best = from;
+        for (std::size_t j = from; j < to && j < n - 1; ++j) {
+            const double area = std::fabs((in[a].t - avg_t) * (in[j].v - in[a].v)
+                                          - (in[a].t - in[j].t) * (avg_v - in[a].v));
+            if (area > best_area) {
+                best_area = area;
+                best = j;
+            }
+        }
+        out.push_back(in[best]);
+        a = best;
+    }
+
+    out.push_back(in.back());
+    return out;
+}
@@ -0,0 +1,63 @@
+#ifndef SERIESPYRAMID_H
+#define SERIESPYRAMID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SamplePoint
+{
+    double t;
+    double v;
+};
+
+// min/max summary of fanout^level consecutive raw samples
+struct SampleBucket
+{
+    double t_first;
+    double t_last;
+    double t_min;
+    double min;
+    double t_max;
+    double max;
+};
+
+/**
+ * Numeric time series of one topic with a multi-resolution min/max pyramid.
+ *
+ * Every level k > 0 summarises fanout^k raw samples per bucket and is
+ * updated in O(levels) on append, so a query for a pixel width only ever
+ * touches O(pixels * fanout) buckets no matter how many samples are stored.
+ * Samples must be appended in non-decreasing time order.
+ */
+class SeriesPyramid
+{
+public:
+    explicit SeriesPyramid(std::size_t fanout = 8);
+
+    void append(double t, double v);
+    void clear();
+
+    std::size_t size() const { return raw.size(); }
+    bool empty() const { return raw.empty(); }
+    double first_time() const { return raw.front().t; }
+    double last_time() const { return raw.back().t; }
+
+    // up to two points (min and max, in time order) per pixel column of [t0, t1]
+    std::vector<SamplePoint> min_max(double t0, double t1, std::size_t pixels) const;
+    // largest-triangle-three-buckets reduction of [t0, t1] to about `pixels` points
+    std::vector<SamplePoint> lttb(double t0, double t1, std::size_t pixels) const;
+
+    static std::vector<SamplePoint> lttb(const std::vector<SamplePoint> &in, std::size_t threshold);
+
+private:
+    std::size_t level_for(std::size_t count, std::size_t pixels) const;
+
+    std::size_t fanout;
+    std::vector<SamplePoint> raw;
+    // levels[k - 1] holds the buckets of level k
+    std::vector<std::vector<SampleBucket>> levels;
+    std::vector<std::size_t> spans;
+};
+
+#endif // SERIESPYRAMID_H
@@ -0,0 +1,253 @@
+#include "snapshot.h"
+#include <QFile>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+const char MAGIC[6] = {'M', 'Q', 'X', 'S', 'N', 'P'};
+const std::uint16_t VERSION = 1;
+const std::size_t HEADER = sizeof(MAGIC) + 2 * sizeof(std::uint16_t);
+const std::size_t SECTION = sizeof(std::uint8_t) + 2 * sizeof(double) + sizeof(std::uint32_t);
+const std::size_t NODE = 2 * sizeof(std::uint32_t) + sizeof(std::uint16_t) + 1 + sizeof(TopicStats);
+const std::size_t BUFFER = 1 << 20;
+
+enum Kind : std::uint8_t { Full = 0, Checkpoint = 1 };
+
+static_assert(std::is_trivially_copyable<TopicStats>::value, "TopicStats is stored raw");
+
+template <typename T>
+void put(std::string &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T get(const char *p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+double wall_clock()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void put_node(std::string &out, const TopicTree::Node &node)
+{
+    const mqtt::const_message_ptr &msg = node.message;
+    put<std::uint32_t>(out, node.id);
+    put<std::uint32_t>(out, node.parent->id);
+    put<std::uint16_t>(out, static_cast<std::uint16_t>(node.name.size()));
+    put<std::uint8_t>(out, msg ? static_cast<std::uint8_t>(1 | (msg->get_qos() & 3) << 1 | (msg->is_retained() ? 8 : 0)
+                                                      | (node.retained ? 16 : 0)) : 0);
+    out.append(reinterpret_cast<const char *>(&node.stats), sizeof(TopicStats));
+    out += node.name;
+    if (!msg)
+        return;
+    const std::string &topic = msg->get_topic();
+    const std::string &payload = msg->get_payload();
+    put<std::uint16_t>(out, static_cast<std::uint16_t>(topic.size()));
+    put<std::uint32_t>(out, static_cast<std::uint32_t>(payload.size()));
+    out += topic;
+    out += payload;
+}
+
+class Writer
+{
+public:
+    Writer(const std::string &path, const char *mode):
+        file(std::fopen(path.c_str(), mode))
+    {
+        if (!file)
+            throw std::runtime_error("cannot write snapshot " + path);
+        buffer.reserve(BUFFER);
+    }
+    ~Writer() { std::fclose(file); }
+
+    std::string buffer;
+    std::size_t written = 0;
+
+    void flush()
+    {
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+            throw std::runtime_error("cannot write snapshot");
+        written += buffer.size();
+        buffer.clear();
+    }
+    // overwrites a u32 at a file offset, which may already be flushed
+    void patch(std::size_t offset, std::uint32_t value)
+    {
+        if (offset >= written) {
+            std::memcpy(&buffer[offset - written], &value, sizeof(value));
+            return;
+        }
+        if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0
+                || std::fwrite(&value, sizeof(value), 1, file) != 1
+                || std::fseek(file, 0, SEEK_END) != 0)
+            throw std::runtime_error("cannot write snapshot");
+    }
+    void close()
+    {
+        flush();
+        if (std::fflush(file) != 0)
+            throw std::runtime_error("cannot write snapshot");
+    }
+
+private:
+    std::FILE *file;
+};
+
+// the size is patched in at the end: a checkpoint is appended in one piece,
+// as a file opened for appending cannot seek back, a whole tree is streamed
+void write_section(Writer &out, TopicTree &tree, Kind kind, const std::vector<std::uint32_t> &ids)
+{
+    std::string &b = out.buffer;
+    const std::size_t start = out.written + b.size();
+    put<std::uint32_t>(b, 0);
+    put<std::uint8_t>(b, kind);
+    put(b, wall_clock());
+    put(b, stats_clock());
+    put<std::uint32_t>(b, static_cast<std::uint32_t>(ids.size()));
+    for (std::uint32_t id : ids) {
+        put_node(b, *tree.node(id));
+        if (kind == Full && b.size() >= BUFFER)
+            out.flush();
+    }
+    out.patch(start, static_cast<std::uint32_t>(out.written + b.size() - start - sizeof(std::uint32_t)));
+    out.flush();
+}
+
+} // namespace
+
+std::size_t save_snapshot(const std::string &path, TopicTree &tree, bool full)
+{
+    std::vector<std::uint32_t> ids = tree.take_touched();
+    if (std::FILE *existing = std::fopen(path.c_str(), "rb"))
+        std::fclose(existing);
+    else
+        full = true;
+    if (!full) {
+        if (ids.empty())
+            return 0;
+        Writer out(path, "ab");
+        write_section(out, tree, Checkpoint, ids);
+        out.close();
+        return out.written;
+    }
+
+    ids.resize(tree.size() - 1);
+    for (std::uint32_t id = 1; id < tree.size(); ++id)
+        ids[id - 1] = id;
+    // a crash while writing leaves the previous snapshot in place
+    const std::string temp = path + ".tmp";
+    std::size_t written;
+    {
+        Writer out(temp, "wb");
+        out.buffer.append(MAGIC, sizeof(MAGIC));
+        put(out.buffer, VERSION);
+        put<std::uint16_t>(out.buffer, sizeof(TopicStats));
+        write_section(out, tree, Full, ids);
+        out.close();
+        written = out.written;
+    }
+    // replaces the previous snapshot in one step, there is always one of them
+#ifdef Q_OS_WIN
+    // rename() refuses an existing target here
+    if (!MoveFileExW(QString::fromStdString(temp).toStdWString().c_str(),
+                     QString::fromStdString(path).toStdWString().c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+    if (std::rename(temp.c_str(), path.c_str()) != 0)
+#endif
+        throw std::runtime_error("cannot replace snapshot " + path);
+    return written;
+}
+
+bool load_snapshot(const std::string &path, TopicTree &tree)
+{
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = file.size();
+    const char *data = size > 0 ? reinterpret_cast<const char *>(file.map(0, size)) : nullptr;
+    if (!data)
+        throw std::runtime_error("cannot map snapshot " + path);
+    const char *p = data, *end = data + size;
+
+    if (size < static_cast<qint64>(HEADER) || std::memcmp(p, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("not a snapshot: " + path);
+    if (get<std::uint16_t>(p + sizeof(MAGIC)) != VERSION
+            || get<std::uint16_t>(p + sizeof(MAGIC) + 2) != sizeof(TopicStats))
+        throw std::runtime_error("snapshot of another version: " + path);
+    p += HEADER;
+
+    // node of every file id; ids are dense, and every parent comes before its children
+    std::vector<TopicTree::Node *> nodes(1, tree.root());
+    const double now_offset = stats_clock() - wall_clock();
+    while (end - p >= static_cast<std::ptrdiff_t>(sizeof(std::uint32_t) + SECTION)) {
+        const std::uint32_t section = get<std::uint32_t>(p);
+        // a checkpoint cut short by a crash ends the file
+        if (section > static_cast<std::size_t>(end - p) - sizeof(std::uint32_t))
+            break;
+        const char *q = p + sizeof(std::uint32_t);
+        const char *section_end = q + section;
+        const double wall = get<double>(q + 1);
+        const double steady = get<double>(q + 1 + sizeof(double));
+        std::uint32_t count = get<std::uint32_t>(q + 1 + 2 * sizeof(double));
+        const double dt = now_offset - (steady - wall);
+        q += SECTION;
+        tree.reserve(tree.size() + count);
+
+        for (; count > 0; --count) {
+            if (section_end - q < static_cast<std::ptrdiff_t>(NODE))
+                throw std::runtime_error("truncated snapshot " + path);
+            const std::uint32_t id = get<std::uint32_t>(q);
+            const std::uint32_t parent = get<std::uint32_t>(q + 4);
+            const std::uint16_t name_size = get<std::uint16_t>(q + 8);
+            const std::uint8_t flags = get<std::uint8_t>(q + 10);
+            TopicStats stats = get<TopicStats>(q + 11);
+            stats.shift(dt);
+            q += NODE;
+            if (section_end - q < name_size || parent >= nodes.size() || !nodes[parent] || id == 0)
+                throw std::runtime_error("corrupt snapshot " + path);
+
+            if (id >= nodes.size())
+                nodes.resize(id + 1);
+            if (!nodes[id])
+                nodes[id] = tree.insert(nodes[parent], std::string(q, name_size));
+            q += name_size;
+
+            mqtt::const_message_ptr msg;
+            if (flags & 1) {
+                if (section_end - q < 6)
+                    throw std::runtime_error("truncated snapshot " + path);
+                const std::uint16_t topic_size = get<std::uint16_t>(q);
+                const std::uint32_t payload_size = get<std::uint32_t>(q + 2);
+                q += 6;
+                if (static_cast<std::size_t>(section_end - q) < std::size_t(topic_size) + payload_size)
+                    throw std::runtime_error("truncated snapshot " + path);
+                msg = mqtt::message::create(std::string(q, topic_size), q + topic_size, payload_size,
+                                            (flags >> 1) & 3, (flags & 8) != 0);
+                q += topic_size + payload_size;
+            }
+            tree.restore(nodes[id], std::move(msg), stats);
+            // a live message may have followed the retained one
+            if (flags & 16)
+                nodes[id]->retained = true;
+        }
+        p = section_end;
+    }
+    // all of it is on disk already
+    tree.take_touched();
+    return true;
+}
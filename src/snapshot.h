@@ -0,0 +1,34 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <string>
+#include "topictree.h"
+
+/*
+ * Snapshot file: an 10 byte header "MQXSNP" + u16 version + u16
+ * sizeof(TopicStats), followed by sections of
+ *
+ *     u32 size of the rest | u8 kind | f64 wall time | f64 steady time |
+ *     u32 node count | nodes
+ *
+ * and nodes of
+ *
+ *     u32 id | u32 parent id | u16 name size | u8 flags | TopicStats |
+ *     name [| u16 topic size | u32 payload size | topic | payload]
+ *
+ * in host byte order. The first section holds the whole tree, every later
+ * one is an incremental checkpoint with only the nodes created or recorded
+ * since the section before. flags holds "has a message" in bit 0, the QoS
+ * in bits 1-2, the retain flag in bit 3 and TopicTree::Node::retained in
+ * bit 4. Statistics are stored raw, so
+ * files only load into builds with the same TopicStats layout; the clock
+ * times of a section move them onto the clock of the loading process.
+ */
+
+// writes the whole tree to path, or appends a checkpoint; returns the bytes written
+std::size_t save_snapshot(const std::string &path, TopicTree &tree, bool full);
+// false if there is no snapshot at path; throws std::runtime_error on a bad one
+bool load_snapshot(const std::string &path, TopicTree &tree);
+
+#endif // SNAPSHOT_H
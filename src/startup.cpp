@@ -0,0 +1,32 @@
+#include "startup.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+const bool enabled = std::getenv("MQTT_EXPLORER_STARTUP") != nullptr;
+
+std::mutex lock;
+std::vector<const char *> seen;
+
+} // namespace
+
+double startup_mark(const char *phase)
+{
+    if (!enabled)
+        return 0;
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+    std::lock_guard<std::mutex> guard(lock);
+    for (const char *p : seen) {
+        if (std::strcmp(p, phase) == 0)
+            return 0;
+    }
+    seen.push_back(phase);
+    std::cerr << "startup: " << phase << " at " << ms << " ms" << std::endl;
+    return ms;
+}
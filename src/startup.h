@@ -0,0 +1,18 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+/**
+ * Startup timeline, printed to stderr when MQTT_EXPLORER_STARTUP is set.
+ *
+ * Times are taken from static initialisation of the executable, so the
+ * first mark already includes the dynamic loader and library constructors.
+ * Only the first mark of every phase is kept, later connects do not count.
+ * Callable from any thread.
+ */
+// milliseconds since start, 0 when disabled or when the phase was marked before
+double startup_mark(const char *phase);
+
+// the window should be on screen within this many milliseconds
+const double STARTUP_BUDGET_MS = 200;
+
+#endif // STARTUP_H
@@ -0,0 +1,324 @@
+#include "subscriptions.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// reason codes from here on refuse the filter, in MQTT 3.1.1 and 5 alike
+const int REFUSED = 0x80;
+
+bool same_options(const mqtt::subscribe_options &a, const mqtt::subscribe_options &b)
+{
+    return a.get_no_local() == b.get_no_local()
+        && a.get_retain_as_published() == b.get_retain_as_published()
+        && a.get_retain_handling() == b.get_retain_handling();
+}
+
+} // namespace
+
+struct SubscriptionManager::State
+{
+    struct Entry
+    {
+        int qos = 0;
+        mqtt::subscribe_options options;
+        Status status = Status::Pending;
+        int reason = 0;
+        // bumped whenever the filter is subscribed anew, older acks are ignored
+        std::uint64_t generation = 0;
+    };
+
+    struct Op
+    {
+        bool subscribe;
+        std::string filter;
+        std::uint64_t generation;
+    };
+
+    State(std::size_t per_request, std::size_t in_flight_max):
+        per_request(std::max<std::size_t>(per_request, 1)),
+        in_flight_max(std::max<std::size_t>(in_flight_max, 1)) {}
+
+    void subscribe(const std::string &filter, Entry &entry)
+    {
+        entry.status = Status::Pending;
+        entry.reason = 0;
+        entry.generation = ++generations;
+        queue.push_back(Op{true, filter, entry.generation});
+    }
+
+    void issue(const std::shared_ptr<State> &self);
+    void acknowledged(const std::vector<Op> &ops, std::uint64_t epoch, const std::vector<int> &codes, int failed,
+                      bool lost);
+
+    const std::size_t per_request;
+    const std::size_t in_flight_max;
+
+    mutable std::mutex lock;
+    mqtt::async_client *client = nullptr;
+    std::unordered_map<std::string, Entry> filters;
+    std::deque<Op> queue;
+    // dropped filters not yet unsubscribed, a kept session still has them
+    std::unordered_set<std::string> unsubscribing;
+    std::uint64_t generations = 0;
+    // bumped per connection; requests of an older one no longer count as in flight
+    std::uint64_t epoch = 0;
+    std::size_t in_flight = 0;
+    std::uint64_t requests = 0;
+};
+
+/*
+ * One SUBSCRIBE or UNSUBSCRIBE packet. Paho keeps a plain reference to the
+ * listener, so it keeps itself alive until the request is acknowledged.
+ */
+class SubscriptionManager::Request : public mqtt::iaction_listener
+{
+public:
+    Request(std::shared_ptr<State> state, bool subscribe, std::uint64_t epoch):
+        state(std::move(state)), subscribe(subscribe), epoch(epoch) {}
+
+    void on_success(const mqtt::token &token) override
+    {
+        std::vector<int> codes;
+        if (subscribe) {
+            try {
+                // returned by value, the codes must not outlive it
+                const mqtt::subscribe_response response = token.get_subscribe_response();
+                for (mqtt::ReasonCode code : response.get_reason_codes())
+                    codes.push_back(static_cast<int>(code));
+            } catch (const mqtt::exception &) {
+                // no SUBACK details, the filters count as granted
+            }
+        }
+        done(codes, 0);
+    }
+
+    void on_failure(const mqtt::token &token) override
+    {
+        const int rc = token.get_return_code();
+        // lost with the connection, not answered; the filters stay pending for the next connect
+        if (rc == MQTTASYNC_DISCONNECTED || rc == MQTTASYNC_OPERATION_INCOMPLETE) {
+            done({}, 0, true);
+            return;
+        }
+        const int reason = token.get_reason_code();
+        done({}, reason >= REFUSED ? reason : REFUSED);
+    }
+
+    void done(const std::vector<int> &codes, int failed, bool lost = false)
+    {
+        const std::shared_ptr<Request> keep = std::move(self);
+        state->acknowledged(ops, epoch, codes, failed, lost);
+        state->issue(state);
+    }
+
+    const std::shared_ptr<State> state;
+    const bool subscribe;
+    const std::uint64_t epoch;
+    std::vector<State::Op> ops;
+    std::shared_ptr<Request> self;
+};
+
+void SubscriptionManager::State::issue(const std::shared_ptr<State> &self)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (client && in_flight < in_flight_max && !queue.empty()) {
+        const bool subscribing = queue.front().subscribe;
+        auto request = std::make_shared<Request>(self, subscribing, epoch);
+        std::vector<std::string> topics;
+        mqtt::iasync_client::qos_collection qos;
+        std::vector<mqtt::subscribe_options> options;
+        while (!queue.empty() && queue.front().subscribe == subscribing && request->ops.size() < per_request) {
+            Op op = std::move(queue.front());
+            queue.pop_front();
+            if (subscribing) {
+                // dropped or changed again since it was queued
+                auto it = filters.find(op.filter);
+                if (it == filters.end() || it->second.generation != op.generation)
+                    continue;
+                qos.push_back(it->second.qos);
+                options.push_back(it->second.options);
+            }
+            topics.push_back(op.filter);
+            request->ops.push_back(std::move(op));
+        }
+        if (request->ops.empty())
+            continue;
+
+        ++in_flight;
+        ++requests;
+        mqtt::async_client *target = client;
+        // built in one go, string_collection::push_back() redoes its C array every time
+        auto collection = std::make_shared<mqtt::string_collection>(std::move(topics));
+        request->self = request;
+        // paho is never called under the lock, its callbacks take it
+        guard.unlock();
+        try {
+            if (subscribing)
+                target->subscribe(collection, qos, nullptr, *request, options);
+            else
+                target->unsubscribe(collection, nullptr, *request);
+        } catch (const mqtt::exception &exc) {
+            request->self.reset();
+            if (exc.get_return_code() != MQTTASYNC_DISCONNECTED) {
+                // paho refused the packet itself, e.g. for a malformed filter; no ack will come
+                acknowledged(request->ops, request->epoch, {}, REFUSED, false);
+                guard.lock();
+                continue;
+            }
+            guard.lock();
+            if (request->epoch == epoch) {
+                // not connected after all; they go first once a request goes out again
+                --in_flight;
+                queue.insert(queue.begin(), request->ops.begin(), request->ops.end());
+            }
+            return;
+        }
+        guard.lock();
+    }
+}
+
+void SubscriptionManager::State::acknowledged(const std::vector<Op> &ops, std::uint64_t of_epoch,
+                                              const std::vector<int> &codes, int failed, bool lost)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    // of an older connection: connected() has decided anew what to send
+    if (of_epoch != epoch)
+        return;
+    --in_flight;
+    if (lost)
+        return;
+    for (std::size_t i = 0; i < ops.size(); ++i) {
+        if (!ops[i].subscribe) {
+            // a failed UNSUBSCRIBE is tried again on the next connect
+            if (!failed)
+                unsubscribing.erase(ops[i].filter);
+            continue;
+        }
+        auto it = filters.find(ops[i].filter);
+        if (it == filters.end() || it->second.generation != ops[i].generation)
+            continue;
+        Entry &entry = it->second;
+        entry.reason = failed ? failed : i < codes.size() ? codes[i] : entry.qos;
+        entry.status = entry.reason >= REFUSED ? Status::Refused : Status::Granted;
+    }
+}
+
+SubscriptionManager::SubscriptionManager(std::size_t per_request, std::size_t in_flight):
+    state(std::make_shared<State>(per_request, in_flight))
+{
+}
+
+SubscriptionManager::~SubscriptionManager()
+{
+    // requests in flight keep the state, they must not issue more
+    disconnected();
+}
+
+void SubscriptionManager::connected(mqtt::async_client &client, bool session_present)
+{
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->client = &client;
+        ++state->epoch;
+        state->in_flight = 0;
+        state->queue.clear();
+        if (session_present) {
+            // the broker kept what it acknowledged; redo what it may have missed
+            for (const std::string &filter : state->unsubscribing)
+                state->queue.push_back(State::Op{false, filter, 0});
+            for (auto &filter : state->filters) {
+                if (filter.second.status == Status::Pending)
+                    state->subscribe(filter.first, filter.second);
+            }
+        } else {
+            state->unsubscribing.clear();
+            for (auto &filter : state->filters)
+                state->subscribe(filter.first, filter.second);
+        }
+    }
+    state->issue(state);
+}
+
+void SubscriptionManager::disconnected()
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->client = nullptr;
+    ++state->epoch;
+    state->in_flight = 0;
+    state->queue.clear();
+}
+
+void SubscriptionManager::set(std::vector<Filter> wanted)
+{
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        std::unordered_map<std::string, State::Entry> next;
+        for (Filter &filter : wanted) {
+            // wanted again; an UNSUBSCRIBE still queued goes out before the new SUBSCRIBE
+            state->unsubscribing.erase(filter.filter);
+            auto it = state->filters.find(filter.filter);
+            if (it != state->filters.end() && it->second.qos == filter.qos
+                    && same_options(it->second.options, filter.options)) {
+                next[filter.filter] = it->second;
+                continue;
+            }
+            State::Entry &entry = next[filter.filter];
+            entry.qos = filter.qos;
+            entry.options = filter.options;
+            state->subscribe(filter.filter, entry);
+        }
+        for (const auto &filter : state->filters) {
+            if (!next.count(filter.first)) {
+                state->unsubscribing.insert(filter.first);
+                state->queue.push_back(State::Op{false, filter.first, 0});
+            }
+        }
+        state->filters.swap(next);
+    }
+    state->issue(state);
+}
+
+std::vector<SubscriptionManager::Filter> SubscriptionManager::wanted() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    std::vector<Filter> out;
+    for (const auto &filter : state->filters)
+        out.push_back(Filter{filter.first, filter.second.qos, filter.second.options});
+    return out;
+}
+
+std::vector<std::pair<std::string, int>> SubscriptionManager::refused() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    std::vector<std::pair<std::string, int>> out;
+    for (const auto &filter : state->filters) {
+        if (filter.second.status == Status::Refused)
+            out.emplace_back(filter.first, filter.second.reason);
+    }
+    return out;
+}
+
+SubscriptionManager::Counters SubscriptionManager::counters() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    Counters c;
+    for (const auto &filter : state->filters) {
+        switch (filter.second.status) {
+        case Status::Pending: ++c.pending; break;
+        case Status::Granted: ++c.granted; break;
+        case Status::Refused: ++c.refused; break;
+        }
+    }
+    c.requests = state->requests;
+    return c;
+}
+
+bool SubscriptionManager::idle() const
+{
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->queue.empty() && state->in_flight == 0;
+}
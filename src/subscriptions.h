@@ -0,0 +1,75 @@
+#ifndef SUBSCRIPTIONS_H
+#define SUBSCRIPTIONS_H
+
+#include <mqtt/async_client.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Keeps the subscriptions of a client equal to a wanted set of filters.
+ *
+ * set() diffs the wanted set against the current one: new filters and
+ * filters whose QoS or options changed are subscribed, dropped ones are
+ * unsubscribed. Up to `per_request` filters share one SUBSCRIBE or
+ * UNSUBSCRIBE packet, and up to `in_flight` requests are outstanding; the
+ * next one is issued from the paho thread as soon as one is acknowledged.
+ * 10000 filters thus take about one round trip plus their transfer
+ * instead of 10000 round trips.
+ *
+ * The SUBACK reason code of every filter is kept, codes from 0x80 on mean
+ * the broker, or paho before sending, refused it. Nothing is issued while disconnected. On a new
+ * session connected() subscribes the whole set again; when the broker kept
+ * the session only what it never acknowledged is sent again. Callable from
+ * any thread.
+ */
+class SubscriptionManager
+{
+public:
+    struct Filter
+    {
+        std::string filter;
+        int qos = 0;
+        mqtt::subscribe_options options;
+    };
+
+    enum class Status { Pending, Granted, Refused };
+
+    struct Counters
+    {
+        std::size_t pending = 0;
+        std::size_t granted = 0;
+        std::size_t refused = 0;
+        // SUBSCRIBE and UNSUBSCRIBE packets issued
+        std::uint64_t requests = 0;
+    };
+
+    explicit SubscriptionManager(std::size_t per_request = 1000, std::size_t in_flight = 16);
+    ~SubscriptionManager();
+    SubscriptionManager(const SubscriptionManager &) = delete;
+    SubscriptionManager &operator=(const SubscriptionManager &) = delete;
+
+    // without a kept session every wanted filter is subscribed on `client` again
+    void connected(mqtt::async_client &client, bool session_present = false);
+    // issues nothing until connected() again
+    void disconnected();
+    void set(std::vector<Filter> wanted);
+
+    std::vector<Filter> wanted() const;
+    // refused filters and their reason codes
+    std::vector<std::pair<std::string, int>> refused() const;
+    Counters counters() const;
+    // nothing queued or in flight
+    bool idle() const;
+
+private:
+    struct State;
+    class Request;
+
+    std::shared_ptr<State> state;
+};
+
+#endif // SUBSCRIPTIONS_H
@@ -0,0 +1,132 @@
+#include "taskpool.h"
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+namespace {
+
+// the pool and worker index of the calling thread, if it is a worker
+thread_local const TaskPool *worker_pool = nullptr;
+thread_local int worker_index = -1;
+// priority of the task the thread runs, lower is more urgent; none outside of one
+thread_local int running_priority = INT_MAX;
+
+} // namespace
+
+TaskPool::TaskPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned i = 0; i < threads; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threads; ++i)
+        workers[i]->thread = std::thread(&TaskPool::run, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker->thread.join();
+}
+
+TaskPool &TaskPool::shared()
+{
+    static TaskPool pool;
+    return pool;
+}
+
+int TaskPool::current() const
+{
+    return worker_pool == this ? worker_index : -1;
+}
+
+void TaskPool::post(Priority priority, std::function<void()> task)
+{
+    const int self = current();
+    Worker &worker = *workers[self >= 0 ? self : next++ % workers.size()];
+    {
+        // counted first, so pending never drops below the queued tasks, and
+        // under the sleep lock, so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> guard(worker.lock);
+        worker.queues[static_cast<int>(priority)].push_back(Task{std::move(task), static_cast<int>(priority), self >= 0});
+    }
+    wake.notify_one();
+}
+
+bool TaskPool::pop(std::deque<Task> &queue, Task &task, bool helping, int priority)
+{
+    auto it = queue.begin();
+    if (helping && priority >= running_priority)
+        it = std::find_if(it, queue.end(), [](const Task &t) { return t.nested; });
+    if (it == queue.end())
+        return false;
+    task = std::move(*it);
+    queue.erase(it);
+    return true;
+}
+
+bool TaskPool::take(int self, Task &task, bool helping)
+{
+    const std::size_t n = workers.size();
+    for (int p = 0; p < PRIORITIES; ++p) {
+        if (self >= 0) {
+            Worker &own = *workers[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (pop(own.queues[p], task, helping, p)) {
+                --pending;
+                return true;
+            }
+        }
+        const std::size_t start = self >= 0 ? self + 1 : next.load();
+        for (std::size_t i = 0; i < n; ++i) {
+            Worker &victim = *workers[(start + i) % n];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (pop(victim.queues[p], task, helping, p)) {
+                --pending;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TaskPool::run_one()
+{
+    Task task;
+    if (!take(current(), task, true))
+        return false;
+    const int outer = std::exchange(running_priority, task.priority);
+    task.run();
+    running_priority = outer;
+    return true;
+}
+
+void TaskPool::run(unsigned index)
+{
+    worker_pool = this;
+    worker_index = static_cast<int>(index);
+    Task task;
+    for (;;) {
+        if (pending > 0 && take(worker_index, task, false)) {
+            running_priority = task.priority;
+            task.run();
+            task.run = nullptr;
+            running_priority = INT_MAX;
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        // queued tasks are still run on shutdown
+        if (stopping && pending == 0)
+            return;
+        wake.wait(guard, [this] { return stopping || pending > 0; });
+    }
+}
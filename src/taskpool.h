@@ -0,0 +1,105 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing pool for background work of every subsystem.
+ *
+ * Every worker has one deque per priority. Tasks posted from a worker go
+ * to its own deque, tasks posted from other threads are spread round
+ * robin, and a worker without tasks steals from the others. Tasks are
+ * taken oldest first, so the batches of an ordered pipeline like the
+ * exporter's finish roughly in order. Priorities are strict: no Bulk task starts
+ * while an Interactive or Normal one waits anywhere, so decoding a visible
+ * row overtakes the batches of a running export within one task.
+ *
+ * A task that waits for tasks it submitted must use wait(), which runs
+ * queued tasks meanwhile; blocking a worker otherwise could starve the pool.
+ * It only helps with tasks posted by pool tasks, and with ones more urgent
+ * than the task it is running, so waiting never starts another long job
+ * like a second export inline.
+ */
+class TaskPool
+{
+public:
+    enum class Priority { Interactive, Normal, Bulk };
+
+    // 0 threads: one per core
+    explicit TaskPool(unsigned threads = 0);
+    ~TaskPool();
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    // the pool of the application
+    static TaskPool &shared();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // task must not throw; see submit() for work with a result
+    void post(Priority priority, std::function<void()> task);
+
+    template <typename F>
+    auto submit(Priority priority, F f) -> std::future<decltype(f())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        std::future<decltype(f())> result = task->get_future();
+        post(priority, [task] { (*task)(); });
+        return result;
+    }
+
+    template <typename T>
+    T wait(std::future<T> &future)
+    {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!run_one())
+                future.wait_for(std::chrono::microseconds(200));
+        }
+        return future.get();
+    }
+
+private:
+    static const int PRIORITIES = 3;
+
+    struct Task
+    {
+        std::function<void()> run;
+        int priority = 0;
+        // posted by a pool task, i.e. part of the work of one
+        bool nested = false;
+    };
+
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> queues[PRIORITIES];
+        std::thread thread;
+    };
+
+    void run(unsigned index);
+    // own oldest task, else one of another worker, by priority;
+    // when helping, see wait(), only nested tasks and more urgent ones
+    bool take(int self, Task &task, bool helping);
+    static bool pop(std::deque<Task> &queue, Task &task, bool helping, int priority);
+    bool run_one();
+    int current() const;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<unsigned> next{0};
+    // queued and not yet taken
+    std::atomic<std::size_t> pending{0};
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif // TASKPOOL_H
@@ -0,0 +1,90 @@
+#include "timingwheel.h"
+#include <cmath>
+#include <limits>
+
+TimingWheel::TimingWheel(double start, double tick):
+    tick(tick),
+    current(tick_of(start))
+{
+}
+
+std::uint64_t TimingWheel::tick_of(double time) const
+{
+    if (std::isinf(time))
+        return NONE;
+    return time > 0 ? static_cast<std::uint64_t>(time / tick) : 0;
+}
+
+void TimingWheel::place(std::uint32_t id, std::uint64_t at)
+{
+    if (at == NONE) {
+        placed[id] = NONE;
+        return;
+    }
+    // the current slot is being swept or already was
+    if (at <= current)
+        at = current + 1;
+    else if (at - current >= SPAN)
+        at = current + SPAN - 1;
+    int level = 0;
+    while ((at - current) >> (BITS * (level + 1)))
+        ++level;
+    placed[id] = at;
+    slots[level][(at >> (BITS * level)) & (SLOTS - 1)].push_back(Entry{id, at});
+}
+
+void TimingWheel::set(std::uint32_t id, double deadline)
+{
+    if (id >= deadlines.size()) {
+        deadlines.resize(id + 1, std::numeric_limits<double>::infinity());
+        placed.resize(id + 1, NONE);
+    }
+    deadlines[id] = deadline;
+    const std::uint64_t at = tick_of(deadline);
+    // a later deadline waits until the entry comes due
+    if (at != NONE && (placed[id] == NONE || at < placed[id]))
+        place(id, at);
+}
+
+void TimingWheel::cascade(int level)
+{
+    swept.clear();
+    swept.swap(slots[level][(current >> (BITS * level)) & (SLOTS - 1)]);
+    for (const Entry &entry : swept) {
+        if (placed[entry.id] != entry.at)
+            continue;
+        // due in the slot about to be swept
+        if (entry.at == current)
+            slots[0][current & (SLOTS - 1)].push_back(entry);
+        else
+            place(entry.id, entry.at);
+    }
+}
+
+void TimingWheel::advance(double now, std::vector<std::uint32_t> &due)
+{
+    const std::uint64_t target = tick_of(now);
+    while (current < target) {
+        ++current;
+        // outer rings first, their entries may land in the slot swept below
+        int top = 0;
+        while (top + 1 < LEVELS && !(current & ((std::uint64_t(1) << (BITS * (top + 1))) - 1)))
+            ++top;
+        for (int level = top; level > 0; --level)
+            cascade(level);
+
+        swept.clear();
+        swept.swap(slots[0][current & (SLOTS - 1)]);
+        for (const Entry &entry : swept) {
+            if (placed[entry.id] != entry.at)
+                continue;
+            const std::uint64_t at = tick_of(deadlines[entry.id]);
+            if (at <= current) {
+                placed[entry.id] = NONE;
+                due.push_back(entry.id);
+            } else {
+                place(entry.id, at);
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Deadlines by small integer id, e.g. a TopicTree node id.
+ *
+ * A hierarchical timing wheel: LEVELS rings of SLOTS slots, where a slot
+ * of level k spans SLOTS^k ticks. set() only stores the deadline as long
+ * as the id's entry in the wheel is due no later; an entry that comes due
+ * with its deadline moved on meanwhile is put back at the new one. A
+ * topic updated many times per deadline thus costs a store per message,
+ * and advance() only touches entries whose slot comes up, never all ids.
+ * Deadlines further out than the wheel spans are revisited at its end.
+ */
+class TimingWheel
+{
+public:
+    // time is whatever clock the deadlines use, seconds; start is its current value
+    TimingWheel(double start, double tick);
+
+    // id comes due at deadline instead of any earlier set(); an infinite one never
+    void set(std::uint32_t id, double deadline);
+    // appends the ids that came due by now, each once per set()
+    void advance(double now, std::vector<std::uint32_t> &due);
+
+private:
+    static constexpr int BITS = 6;
+    static constexpr std::uint64_t SLOTS = 1 << BITS;
+    static constexpr int LEVELS = 4;
+    static constexpr std::uint64_t SPAN = std::uint64_t(1) << (BITS * LEVELS);
+    static constexpr std::uint64_t NONE = ~std::uint64_t(0);
+
+    struct Entry
+    {
+        std::uint32_t id;
+        // tick the entry was put in for, stale once the id has an earlier one
+        std::uint64_t at;
+    };
+
+    std::uint64_t tick_of(double time) const;
+    void place(std::uint32_t id, std::uint64_t at);
+    void cascade(int level);
+
+    double tick;
+    std::uint64_t current;
+    std::vector<double> deadlines;
+    // tick of the id's live entry, NONE without one
+    std::vector<std::uint64_t> placed;
+    std::vector<Entry> slots[LEVELS][SLOTS];
+    std::vector<Entry> swept;
+};
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,127 @@
+#include "tokenawait.h"
+#include <QTimer>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// resumes the coroutine when called, destroys it if dropped uncalled
+class Resume
+{
+public:
+    explicit Resume(std::coroutine_handle<> handle): handle(handle) {}
+    Resume(Resume &&other) noexcept: handle(std::exchange(other.handle, nullptr)) {}
+    Resume &operator=(Resume &&) = delete;
+    ~Resume()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    void operator()() { std::exchange(handle, nullptr).resume(); }
+
+private:
+    std::coroutine_handle<> handle;
+};
+
+} // namespace
+
+struct TokenListener::Alive
+{
+    std::mutex lock;
+    bool alive = true;
+};
+
+namespace {
+
+/*
+ * Child of a context, one per context. Destroyed with it, under the lock
+ * complete() posts under, so a resume is either posted before, and
+ * dropped with the context's other posted events, or not at all.
+ */
+class AliveGuard : public QObject
+{
+public:
+    static const char *const NAME;
+
+    AliveGuard(QObject *context, std::shared_ptr<TokenListener::Alive> alive):
+        QObject(context), alive(std::move(alive))
+    {
+        setObjectName(NAME);
+    }
+    ~AliveGuard() override
+    {
+        std::lock_guard<std::mutex> guard(alive->lock);
+        alive->alive = false;
+    }
+
+    const std::shared_ptr<TokenListener::Alive> alive;
+};
+
+const char *const AliveGuard::NAME = "TokenListener::Alive";
+
+} // namespace
+
+std::shared_ptr<TokenListener> TokenListener::create(QObject *context)
+{
+    auto *guard = static_cast<AliveGuard *>(context->findChild<QObject *>(AliveGuard::NAME, Qt::FindDirectChildrenOnly));
+    if (!guard)
+        guard = new AliveGuard(context, std::make_shared<Alive>());
+    std::shared_ptr<TokenListener> listener(new TokenListener(context, guard->alive));
+    listener->self = listener;
+    return listener;
+}
+
+bool TokenListener::done() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return finished;
+}
+
+bool TokenListener::suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (finished)
+        return false;
+    waiting = handle;
+    return true;
+}
+
+void TokenListener::release()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    self.reset();
+}
+
+void TokenListener::complete()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    finished = true;
+    const std::coroutine_handle<> handle = std::exchange(waiting, nullptr);
+    // the awaiter may be gone by now, this keeps the listener alive until return
+    const std::shared_ptr<TokenListener> keep = std::move(self);
+    guard.unlock();
+    if (!handle)
+        return;
+    // with the context gone there is no event loop to resume on, dropping resume destroys the coroutine
+    Resume resume(handle);
+    std::lock_guard<std::mutex> alive_guard(alive->lock);
+    if (alive->alive)
+        QMetaObject::invokeMethod(context, std::move(resume), Qt::QueuedConnection);
+}
+
+void After::await_suspend(std::coroutine_handle<> waiting)
+{
+    QTimer::singleShot(static_cast<int>(seconds * 1000), context, Resume(waiting));
+}
+
+void Detached::promise_type::unhandled_exception()
+{
+    try {
+        throw;
+    } catch (const mqtt::exception &exc) {
+        std::cerr << "Error: " << exc.what() << " [" << exc.get_reason_code() << "]" << std::endl;
+    } catch (const std::exception &exc) {
+        std::cerr << "Error: " << exc.what() << std::endl;
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef TOKENAWAIT_H
+#define TOKENAWAIT_H
+
+#include <QObject>
+#include <mqtt/async_client.h>
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * co_await for paho requests, resumed on the Qt event loop.
+ *
+ * The await_*() functions issue the request right away with a listener
+ * attached, so any number of requests can be in flight before the first
+ * co_await:
+ *
+ *     std::vector<TokenAwait<mqtt::token_ptr>> acks;
+ *     for (const std::string &filter : filters)
+ *         acks.push_back(await_request(this, [&](mqtt::iaction_listener &listener) {
+ *             return client.subscribe(filter, 0, nullptr, listener);
+ *         }));
+ *     for (auto &ack : acks)
+ *         co_await ack;   // one round trip for all of them
+ *
+ * A coroutine that has to suspend continues in the thread of `context`,
+ * from its event loop, never on a paho thread. co_await yields the token,
+ * or throws mqtt::exception as token::wait() would; one that is done
+ * already does not suspend. A coroutine still suspended when `context`
+ * is destroyed is destroyed with it, as is one whose request completes
+ * after that.
+ */
+class TokenListener : public mqtt::iaction_listener
+{
+public:
+    // keeps itself alive until paho reports the request done; called in context's thread
+    static std::shared_ptr<TokenListener> create(QObject *context);
+
+    bool done() const;
+    // false if already done, the caller continues right away
+    bool suspend(std::coroutine_handle<> waiting);
+    // the request was not issued, no report will come
+    void release();
+
+    void on_success(const mqtt::token &) override { complete(); }
+    void on_failure(const mqtt::token &) override { complete(); }
+
+    // cleared by the destruction of a context, see tokenawait.cpp
+    struct Alive;
+
+private:
+    TokenListener(QObject *context, std::shared_ptr<Alive> alive):
+        context(context), alive(std::move(alive)) {}
+    void complete();
+
+    QObject *const context;
+    const std::shared_ptr<Alive> alive;
+    mutable std::mutex lock;
+    bool finished = false;
+    std::coroutine_handle<> waiting;
+    std::shared_ptr<TokenListener> self;
+};
+
+// T is mqtt::token_ptr or mqtt::delivery_token_ptr
+template <typename T>
+class TokenAwait
+{
+public:
+    TokenAwait(std::shared_ptr<TokenListener> listener, T token):
+        listener(std::move(listener)), issued(std::move(token)) {}
+
+    const T &token() const { return issued; }
+
+    bool await_ready() const { return listener->done(); }
+    bool await_suspend(std::coroutine_handle<> waiting) { return listener->suspend(waiting); }
+    T await_resume()
+    {
+        // complete by now, only throws for a failed request
+        issued->wait();
+        return issued;
+    }
+
+private:
+    std::shared_ptr<TokenListener> listener;
+    T issued;
+};
+
+// request(listener) issues a request with the listener and returns its token
+template <typename F>
+auto await_request(QObject *context, F request) -> TokenAwait<decltype(request(std::declval<mqtt::iaction_listener &>()))>
+{
+    std::shared_ptr<TokenListener> listener = TokenListener::create(context);
+    try {
+        return {listener, request(*listener)};
+    } catch (...) {
+        listener->release();
+        throw;
+    }
+}
+
+inline TokenAwait<mqtt::token_ptr> await_connect(QObject *context, mqtt::async_client &client,
+                                                 mqtt::connect_options options)
+{
+    return await_request(context, [&](mqtt::iaction_listener &listener) {
+        return client.connect(std::move(options), nullptr, listener);
+    });
+}
+
+// continues the coroutine that many seconds later, from the event loop of context's thread
+struct After
+{
+    QObject *context;
+    double seconds;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> waiting);
+    void await_resume() {}
+};
+
+inline After after(QObject *context, double seconds) { return {context, seconds}; }
+
+/**
+ * Return type of a coroutine started from a slot that nobody awaits.
+ * It runs until its first suspension right away; an exception escaping
+ * it is reported on stderr.
+ */
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+    };
+};
+
+#endif // TOKENAWAIT_H
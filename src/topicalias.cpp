@@ -0,0 +1,55 @@
+#include "topicalias.h"
+
+TopicAliases::TopicAliases(ConcurrentTopicTrie &trie):
+    trie(trie)
+{
+}
+
+void TopicAliases::reset()
+{
+    bindings.clear();
+}
+
+mqtt::const_message_ptr TopicAliases::resolve(mqtt::const_message_ptr msg, ConcurrentTopicTrie::Node *&node)
+{
+    messages.fetch_add(1, std::memory_order_relaxed);
+    const mqtt::properties &props = msg->get_properties();
+    if (props.empty() || !props.contains(mqtt::property::TOPIC_ALIAS)) {
+        node = trie.intern(msg->get_topic());
+        return msg;
+    }
+
+    const std::uint16_t alias = mqtt::get<std::uint16_t>(props, mqtt::property::TOPIC_ALIAS);
+    if (alias == 0) {
+        // not a valid alias, the topic is all there is
+        node = trie.intern(msg->get_topic());
+        return msg;
+    }
+    if (!msg->get_topic().empty()) {
+        if (alias >= bindings.size())
+            bindings.resize(alias + 1);
+        bindings[alias].topic = msg->get_topic_ref();
+        bindings[alias].node = node = trie.intern(msg->get_topic());
+        bound.fetch_add(1, std::memory_order_relaxed);
+        return msg;
+    }
+
+    if (alias >= bindings.size() || !bindings[alias].node) {
+        unknown.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    const Binding &b = bindings[alias];
+    node = b.node;
+    return mqtt::message::create(b.topic, msg->get_payload_ref(), msg->get_qos(), msg->is_retained(), props);
+}
+
+TopicAliases::Counters TopicAliases::counters() const
+{
+    Counters c;
+    c.messages = messages.load(std::memory_order_relaxed);
+    c.bound = bound.load(std::memory_order_relaxed);
+    c.hits = hits.load(std::memory_order_relaxed);
+    c.unknown = unknown.load(std::memory_order_relaxed);
+    return c;
+}
@@ -0,0 +1,62 @@
+#ifndef TOPICALIAS_H
+#define TOPICALIAS_H
+
+#include <mqtt/message.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "concurrenttrie.h"
+
+/**
+ * Inbound MQTT 5 topic aliases of one network connection.
+ *
+ * The Paho C library passes aliases through untouched: a PUBLISH with a
+ * topic and an alias binds the alias, one with only the alias means the
+ * bound topic. resolve() has to see messages in arrival order. It keeps
+ * the bound topic string and its node in the live trie, so an alias-only
+ * message gets its topic back by sharing that string, payload untouched,
+ * and its trie node without any hashing.
+ */
+class TopicAliases
+{
+public:
+    // advertised in CONNECT as Topic Alias Maximum
+    static constexpr std::uint16_t MAXIMUM = 65535;
+
+    struct Counters
+    {
+        std::uint64_t messages = 0;
+        // messages that bound an alias
+        std::uint64_t bound = 0;
+        // messages that only carried an alias
+        std::uint64_t hits = 0;
+        // alias-only messages with an alias never bound, dropped
+        std::uint64_t unknown = 0;
+    };
+
+    explicit TopicAliases(ConcurrentTopicTrie &trie);
+
+    // aliases die with the connection
+    void reset();
+    // msg with its topic filled in, or null if it cannot be resolved;
+    // node is set to the topic's node in the trie
+    mqtt::const_message_ptr resolve(mqtt::const_message_ptr msg, ConcurrentTopicTrie::Node *&node);
+    Counters counters() const;
+
+private:
+    struct Binding
+    {
+        mqtt::string_ref topic;
+        ConcurrentTopicTrie::Node *node = nullptr;
+    };
+
+    ConcurrentTopicTrie &trie;
+    std::vector<Binding> bindings;
+    // written in resolve(), read by the GUI
+    std::atomic<std::uint64_t> messages{0};
+    std::atomic<std::uint64_t> bound{0};
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> unknown{0};
+};
+
+#endif // TOPICALIAS_H
@@ -0,0 +1,136 @@
+#include "topicmodel.h"
+#include <QColor>
+
+TopicModel::TopicModel(QObject *parent):
+    QAbstractItemModel(parent)
+{
+    topics.set_listener(this);
+}
+
+TopicTree::Node *TopicModel::node(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return topics.root();
+    return static_cast<TopicTree::Node *>(index.internalPointer());
+}
+
+TopicTree::Node *TopicModel::record(mqtt::const_message_ptr msg)
+{
+    return topics.record(std::move(msg), stats_clock());
+}
+
+void TopicModel::adopt(TopicTree &&tree)
+{
+    beginResetModel();
+    const double idle = topics.idle_expiry();
+    topics = std::move(tree);
+    topics.set_listener(this);
+    // built without one, the setting belongs to the view
+    if (idle > 0)
+        topics.set_idle_expiry(idle);
+    endResetModel();
+}
+
+QModelIndex TopicModel::index_of(TopicTree::Node *node) const
+{
+    if (!node || !node->parent)
+        return QModelIndex();
+    return createIndex(static_cast<int>(node->row), 0, node);
+}
+
+QModelIndex TopicModel::index(int row, int column, const QModelIndex &parent) const
+{
+    TopicTree::Node *p = node(parent);
+    if (row < 0 || row >= static_cast<int>(p->children.size()) || column < 0 || column >= ColumnCount)
+        return QModelIndex();
+    return createIndex(row, column, p->children[row]);
+}
+
+QModelIndex TopicModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return QModelIndex();
+    return index_of(node(index)->parent);
+}
+
+int TopicModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return static_cast<int>(node(parent)->children.size());
+}
+
+int TopicModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+QVariant TopicModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    TopicTree::Node *n = node(index);
+    if (role == Qt::ForegroundRole)
+        return n->stale || n->expired ? QVariant(QColor(Qt::gray)) : QVariant();
+    if (role == Qt::ToolTipRole) {
+        if (n->stale)
+            return tr("The broker no longer holds this retained message");
+        if (n->expired)
+            return n->message->get_properties().contains(mqtt::property::MESSAGE_EXPIRY_INTERVAL)
+                    ? tr("The message expired") : tr("No message for %1 s").arg(topics.idle_expiry());
+        return QVariant();
+    }
+    if (role != Qt::DisplayRole)
+        return QVariant();
+    if (index.column() == TopicColumn)
+        return QString::fromStdString(n->name);
+
+    const double now = stats_clock();
+    const TopicStats &s = topics.subtree_stats(n, now);
+    switch (index.column()) {
+    case MessagesColumn:
+        return QVariant::fromValue<qulonglong>(s.messages());
+    case RateColumn:
+        return QString::number(s.message_rate(now), 'f', 1);
+    case ByteRateColumn:
+        return QString::number(s.byte_rate(now), 'f', 0);
+    case SizeP50Column:
+        return QVariant::fromValue<qulonglong>(s.sizes().quantile(0.5));
+    case SizeP99Column:
+        return QVariant::fromValue<qulonglong>(s.sizes().quantile(0.99));
+    case JitterColumn:
+        return QString::number(s.jitter() * 1000, 'f', 1);
+    case LastSeenColumn:
+        return s.messages() ? QString::number(now - s.last_seen(), 'f', 1) : QString();
+    }
+    return QVariant();
+}
+
+QVariant TopicModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case TopicColumn: return tr("Topic");
+    case MessagesColumn: return tr("Messages");
+    case RateColumn: return tr("Msg/s");
+    case ByteRateColumn: return tr("B/s");
+    case SizeP50Column: return tr("Size p50");
+    case SizeP99Column: return tr("Size p99");
+    case JitterColumn: return tr("Jitter ms");
+    case LastSeenColumn: return tr("Seen s ago");
+    }
+    return QVariant();
+}
+
+void TopicModel::node_adding(TopicTree::Node *parent, int row)
+{
+    beginInsertRows(index_of(parent), row, row);
+}
+
+void TopicModel::node_added(TopicTree::Node *)
+{
+    endInsertRows();
+}
@@ -0,0 +1,55 @@
+#ifndef TOPICMODEL_H
+#define TOPICMODEL_H
+
+#include <QAbstractItemModel>
+#include "topictree.h"
+
+/**
+ * Item model over the TopicTree.
+ *
+ * Statistics columns show the rollup of the whole subtree. Rollups are
+ * computed in data(), so only rows the view actually paints pay for them.
+ * Topics whose retained message went stale in a resync, or that expired,
+ * are grayed out.
+ */
+class TopicModel : public QAbstractItemModel, private TopicTree::Listener
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        TopicColumn,
+        MessagesColumn,
+        RateColumn,
+        ByteRateColumn,
+        SizeP50Column,
+        SizeP99Column,
+        JitterColumn,
+        LastSeenColumn,
+        ColumnCount
+    };
+
+    explicit TopicModel(QObject *parent = nullptr);
+
+    TopicTree &tree() { return topics; }
+    TopicTree::Node *node(const QModelIndex &index) const;
+    TopicTree::Node *record(mqtt::const_message_ptr msg);
+    // replaces the whole tree, e.g. with one built off the GUI thread
+    void adopt(TopicTree &&tree);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void node_adding(TopicTree::Node *parent, int row) override;
+    void node_added(TopicTree::Node *node) override;
+    QModelIndex index_of(TopicTree::Node *node) const;
+
+    mutable TopicTree topics;
+};
+
+#endif // TOPICMODEL_H
@@ -0,0 +1,143 @@
+#include "topicstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+double stats_clock()
+{
+    const std::chrono::duration<double> t = std::chrono::steady_clock::now().time_since_epoch();
+    return t.count();
+}
+
+int SizeSketch::bucket_of(std::size_t bytes)
+{
+    if (bytes == 0)
+        return 0;
+    int msb = 0;
+    while ((bytes >> msb) > 1)
+        ++msb;
+    const int half = msb > 0 ? static_cast<int>((bytes >> (msb - 1)) & 1) : 0;
+    return std::min(1 + 2 * msb + half, BUCKETS - 1);
+}
+
+std::size_t SizeSketch::value_of(int bucket)
+{
+    if (bucket == 0)
+        return 0;
+    const int msb = (bucket - 1) / 2;
+    const double lower = std::ldexp(1.0 + 0.5 * ((bucket - 1) % 2), msb);
+    return static_cast<std::size_t>(lower * (bucket % 2 ? 1.25 : 1.0 + 1.0 / 6));
+}
+
+void SizeSketch::add(std::size_t bytes)
+{
+    std::uint16_t &c = counts[bucket_of(bytes)];
+    if (c == UINT16_MAX) {
+        for (std::uint16_t &n : counts)
+            n /= 2;
+    }
+    ++c;
+}
+
+void SizeSketch::merge(const SizeSketch &other)
+{
+    std::array<std::uint32_t, BUCKETS> sum;
+    std::uint32_t top = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        sum[i] = std::uint32_t(counts[i]) + other.counts[i];
+        top = std::max(top, sum[i]);
+    }
+    int shift = 0;
+    while ((top >> shift) > UINT16_MAX)
+        ++shift;
+    for (int i = 0; i < BUCKETS; ++i)
+        counts[i] = static_cast<std::uint16_t>(sum[i] >> shift);
+}
+
+std::size_t SizeSketch::quantile(double q) const
+{
+    std::uint64_t total = 0;
+    for (std::uint16_t c : counts)
+        total += c;
+    if (total == 0)
+        return 0;
+
+    const std::uint64_t rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * (total - 1));
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen > rank)
+            return value_of(i);
+    }
+    return value_of(BUCKETS - 1);
+}
+
+void TopicStats::record(double now, std::size_t payload)
+{
+    const double decay = count ? std::exp(-(now - rate_at) / TAU) : 0;
+    msg_rate = msg_rate * decay + 1.0 / TAU;
+    bytes_rate = bytes_rate * decay + payload / TAU;
+    rate_at = now;
+
+    // RFC 3550 style smoothing of the inter-arrival time and its deviation
+    if (count > 0) {
+        const double dt = now - last;
+        if (count == 1)
+            interval = dt;
+        jitter_s += (std::fabs(dt - interval) - jitter_s) / 16;
+        interval += (dt - interval) / 16;
+    }
+
+    ++count;
+    bytes += payload;
+    last = now;
+    size_sketch.add(payload);
+}
+
+void TopicStats::fold(double now, std::uint64_t messages, std::uint64_t payload)
+{
+    // they count towards totals and rates, their timing and sizes are unknown
+    if (messages == 0 || count == 0)
+        return;
+    const double decay = std::exp(-(now - rate_at) / TAU);
+    msg_rate = msg_rate * decay + messages / TAU;
+    bytes_rate = bytes_rate * decay + payload / TAU;
+    rate_at = now;
+    count += messages;
+    bytes += payload;
+}
+
+void TopicStats::merge(const TopicStats &other, double now)
+{
+    if (other.count == 0)
+        return;
+
+    const double total = double(count) + other.count;
+    jitter_s = (jitter_s * count + other.jitter_s * other.count) / total;
+    interval = (interval * count + other.interval * other.count) / total;
+
+    msg_rate = message_rate(now) + other.message_rate(now);
+    bytes_rate = byte_rate(now) + other.byte_rate(now);
+    rate_at = now;
+
+    count += other.count;
+    bytes += other.bytes;
+    last = std::max(last, other.last);
+    size_sketch.merge(other.size_sketch);
+}
+
+void TopicStats::shift(double dt)
+{
+    last += dt;
+    rate_at += dt;
+}
+
+double TopicStats::message_rate(double now) const
+{
+    return count ? msg_rate * std::exp(-std::max(now - rate_at, 0.0) / TAU) : 0;
+}
+
+double TopicStats::byte_rate(double now) const
+{
+    return count ? bytes_rate * std::exp(-std::max(now - rate_at, 0.0) / TAU) : 0;
+}
@@ -0,0 +1,74 @@
+#ifndef TOPICSTATS_H
+#define TOPICSTATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// seconds on the steady clock, the time base of all statistics
+double stats_clock();
+
+/**
+ * Payload size distribution in constant memory.
+ *
+ * DDSketch-like log histogram with two buckets per power of two, which
+ * keeps quantiles within ~20 % of the true size from 0 B up to the 256 MB
+ * MQTT limit. Counters are 16 bit; when one would overflow the whole
+ * histogram is halved, which keeps the shape and favours recent traffic.
+ */
+class SizeSketch
+{
+public:
+    static constexpr int BUCKETS = 60;
+
+    void add(std::size_t bytes);
+    void merge(const SizeSketch &other);
+    std::size_t quantile(double q) const;
+
+private:
+    static int bucket_of(std::size_t bytes);
+    static std::size_t value_of(int bucket);
+
+    std::array<std::uint16_t, BUCKETS> counts{};
+};
+
+/**
+ * Constant-memory traffic statistics of a topic or of a whole subtree.
+ *
+ * Rates are exponentially decayed with time constant TAU and are only
+ * decayed when read, so recording a message is a handful of flops.
+ */
+class TopicStats
+{
+public:
+    static constexpr double TAU = 10.0;
+
+    void record(double now, std::size_t bytes);
+    // messages conflated away before they could be recorded, see LastValueCache
+    void fold(double now, std::uint64_t messages, std::uint64_t bytes);
+    void merge(const TopicStats &other, double now);
+    // moves every timestamp by dt, e.g. onto the clock of another process
+    void shift(double dt);
+
+    std::uint64_t messages() const { return count; }
+    std::uint64_t total_bytes() const { return bytes; }
+    double last_seen() const { return last; }
+    double message_rate(double now) const;
+    double byte_rate(double now) const;
+    // mean absolute deviation of the inter-arrival time, in seconds
+    double jitter() const { return jitter_s; }
+    const SizeSketch &sizes() const { return size_sketch; }
+
+private:
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+    double last = 0;
+    double rate_at = 0;
+    double msg_rate = 0;
+    double bytes_rate = 0;
+    double interval = 0;
+    double jitter_s = 0;
+    SizeSketch size_sketch;
+};
+
+#endif // TOPICSTATS_H
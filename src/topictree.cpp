@@ -0,0 +1,301 @@
+#include "topictree.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+std::size_t topic_hash(const std::string &topic)
+{
+    return std::hash<std::string>()(topic);
+}
+
+// the probe start as well: growing rehashes from the slot alone, without
+// reading the node's topic, so tags must be spread over all 32 bits
+std::uint32_t tag_of(std::size_t hash)
+{
+    if (sizeof(std::size_t) > sizeof(std::uint32_t))
+        return static_cast<std::uint32_t>(static_cast<std::uint64_t>(hash) >> 32);
+    return static_cast<std::uint32_t>(hash);
+}
+
+} // namespace
+
+TopicTree::TopicTree():
+    deadlines(stats_clock(), EXPIRY_TICK)
+{
+    nodes.emplace_back();
+}
+
+TopicTree::Node *TopicTree::child(Node *parent, const std::string &name) const
+{
+    if (parent->index) {
+        auto it = parent->index->find(name);
+        return it == parent->index->end() ? nullptr : it->second;
+    }
+    for (Node *c : parent->children) {
+        if (c->name == name)
+            return c;
+    }
+    return nullptr;
+}
+
+TopicTree::Node *TopicTree::add_child(Node *parent, std::string name)
+{
+    const int row = static_cast<int>(parent->children.size());
+    if (listener)
+        listener->node_adding(parent, row);
+
+    nodes.emplace_back();
+    Node *node = &nodes.back();
+    node->parent = parent;
+    node->name = std::move(name);
+    node->id = static_cast<std::uint32_t>(nodes.size() - 1);
+    node->row = static_cast<std::uint32_t>(row);
+    parent->children.push_back(node);
+
+    if (parent->index) {
+        parent->index->emplace(node->name, node);
+    } else if (parent->children.size() > INDEX_THRESHOLD) {
+        parent->index = std::make_unique<std::unordered_map<std::string, Node *>>();
+        for (Node *c : parent->children)
+            parent->index->emplace(c->name, c);
+    }
+
+    touch(node);
+    if (listener)
+        listener->node_added(node);
+    return node;
+}
+
+TopicTree::Node *TopicTree::flat_find(const std::string &topic, std::size_t hash)
+{
+    if (flat.empty())
+        return nullptr;
+    const std::size_t mask = flat.size() - 1;
+    const std::uint32_t tag = tag_of(hash);
+    for (std::size_t i = tag & mask; flat[i].id; i = (i + 1) & mask) {
+        if (flat[i].tag != tag)
+            continue;
+        Node *node = &nodes[flat[i].id];
+        if (node->message->get_topic() == topic)
+            return node;
+    }
+    return nullptr;
+}
+
+void TopicTree::flat_grow(std::size_t capacity)
+{
+    std::vector<FlatSlot> old(capacity);
+    old.swap(flat);
+    const std::size_t mask = flat.size() - 1;
+    for (const FlatSlot &slot : old) {
+        if (!slot.id)
+            continue;
+        std::size_t i = slot.tag & mask;
+        while (flat[i].id)
+            i = (i + 1) & mask;
+        flat[i] = slot;
+    }
+}
+
+void TopicTree::flat_insert(const Node *node, std::size_t hash)
+{
+    if ((flat_used + 1) * 2 > flat.size())
+        flat_grow(std::max<std::size_t>(flat.size() * 2, FLAT_INITIAL));
+
+    const std::uint32_t tag = tag_of(hash);
+    const std::size_t mask = flat.size() - 1;
+    std::size_t i = tag & mask;
+    while (flat[i].id)
+        i = (i + 1) & mask;
+    flat[i].id = node->id;
+    flat[i].tag = tag;
+    ++flat_used;
+}
+
+void TopicTree::reserve(std::size_t topics)
+{
+    std::size_t capacity = std::max<std::size_t>(flat.size(), FLAT_INITIAL);
+    while (capacity < 2 * topics)
+        capacity *= 2;
+    if (capacity > flat.size())
+        flat_grow(capacity);
+}
+
+TopicTree::Node *TopicTree::find(const std::string &topic)
+{
+    if (Node *node = flat_find(topic, topic_hash(topic)))
+        return node;
+    Node *node = root();
+    std::size_t begin = 0;
+    while (node) {
+        const std::size_t end = topic.find('/', begin);
+        node = child(node, topic.substr(begin, end - begin));
+        if (end == std::string::npos)
+            break;
+        begin = end + 1;
+    }
+    return node;
+}
+
+TopicTree::Node *TopicTree::insert(const std::string &topic)
+{
+    Node *node = root();
+    std::size_t begin = 0;
+    for (;;) {
+        const std::size_t end = topic.find('/', begin);
+        std::string name = topic.substr(begin, end - begin);
+        Node *next = child(node, name);
+        node = next ? next : add_child(node, std::move(name));
+        if (end == std::string::npos)
+            return node;
+        begin = end + 1;
+    }
+}
+
+TopicTree::Node *TopicTree::record(mqtt::const_message_ptr msg, double now)
+{
+    const std::size_t hash = topic_hash(msg->get_topic());
+    Node *node = flat_find(msg->get_topic(), hash);
+    const bool indexed = node != nullptr;
+    if (!indexed)
+        node = insert(msg->get_topic());
+    node->stats.record(now, msg->get_payload().size());
+    if (msg->is_retained())
+        node->retained = !msg->get_payload().empty();
+    node->message = std::move(msg);
+    node->generation = generation;
+    node->stale = false;
+    schedule(node, now);
+    // only now the node's message can vouch for its topic
+    if (!indexed)
+        flat_insert(node, hash);
+    mark_dirty(node);
+    touch(node);
+    return node;
+}
+
+TopicTree::Node *TopicTree::insert(Node *parent, const std::string &name)
+{
+    Node *node = child(parent, name);
+    return node ? node : add_child(parent, name);
+}
+
+void TopicTree::restore(Node *node, mqtt::const_message_ptr msg, const TopicStats &stats)
+{
+    const bool indexed = node->message != nullptr;
+    node->stats = stats;
+    if (msg) {
+        if (msg->is_retained())
+            node->retained = !msg->get_payload().empty();
+        node->message = std::move(msg);
+        node->generation = generation;
+        node->stale = false;
+        if (!indexed)
+            flat_insert(node, topic_hash(node->message->get_topic()));
+    }
+    if (node->message)
+        schedule(node, stats.last_seen());
+    mark_dirty(node);
+    touch(node);
+}
+
+void TopicTree::touch(Node *node)
+{
+    if (node->touched)
+        return;
+    node->touched = true;
+    touched.push_back(node->id);
+}
+
+std::vector<std::uint32_t> TopicTree::take_touched()
+{
+    std::vector<std::uint32_t> ids;
+    ids.swap(touched);
+    for (std::uint32_t id : ids)
+        nodes[id].touched = false;
+    // a parent is always older than its children
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void TopicTree::begin_resync()
+{
+    ++generation;
+}
+
+void TopicTree::confirm(Node *node)
+{
+    node->generation = generation;
+    node->stale = false;
+}
+
+std::size_t TopicTree::end_resync()
+{
+    std::size_t stale = 0;
+    for (Node &node : nodes) {
+        node.stale = node.retained && node.generation != generation;
+        stale += node.stale;
+    }
+    return stale;
+}
+
+void TopicTree::schedule(Node *node, double seen)
+{
+    if (node->expired) {
+        node->expired = false;
+        --expired_count;
+    }
+    double deadline = idle > 0 ? seen + idle : std::numeric_limits<double>::infinity();
+    const mqtt::properties &props = node->message->get_properties();
+    if (props.contains(mqtt::property::MESSAGE_EXPIRY_INTERVAL))
+        deadline = std::min(deadline, seen + mqtt::get<std::uint32_t>(props, mqtt::property::MESSAGE_EXPIRY_INTERVAL));
+    deadlines.set(node->id, deadline);
+}
+
+void TopicTree::set_idle_expiry(double seconds)
+{
+    idle = seconds;
+    for (Node &node : nodes) {
+        if (node.message)
+            schedule(&node, node.stats.last_seen());
+    }
+}
+
+std::size_t TopicTree::expire(double now)
+{
+    due.clear();
+    deadlines.advance(now, due);
+    for (std::uint32_t id : due)
+        nodes[id].expired = true;
+    // every set() comes due once, and only schedule() sets
+    expired_count += due.size();
+    return due.size();
+}
+
+void TopicTree::mark_dirty(Node *node)
+{
+    // a dirty node always has dirty ancestors, so stop at the first one
+    for (; node && !node->dirty; node = node->parent)
+        node->dirty = true;
+}
+
+const TopicStats &TopicTree::subtree_stats(Node *node, double now)
+{
+    if (node->dirty) {
+        node->subtree = node->stats;
+        for (Node *c : node->children)
+            node->subtree.merge(subtree_stats(c, now), now);
+        node->dirty = false;
+    }
+    return node->subtree;
+}
+
+std::string TopicTree::path(const Node *node) const
+{
+    std::string result;
+    for (; node && node->parent; node = node->parent)
+        result = node->parent->parent ? "/" + node->name + result : node->name + result;
+    return result;
+}
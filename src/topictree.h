@@ -0,0 +1,150 @@
+#ifndef TOPICTREE_H
+#define TOPICTREE_H
+
+#include <mqtt/message.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "timingwheel.h"
+#include "topicstats.h"
+
+/**
+ * Trie of topic levels, one node per level as in the MQTT topic name.
+ *
+ * Nodes live in a deque, so they never move and their id is their index.
+ * Children keep arrival order, which makes a node's row in its parent
+ * stable for the item model.
+ *
+ * Topics that hold a message are also in a flat open-addressing index from
+ * the full topic to the node id. Known topics are then found by hashing the
+ * topic once and comparing it with the node's message topic, and only new
+ * topics descend the tree level by level.
+ *
+ * Topics expire once nothing was recorded for the idle expiry, or once an
+ * MQTT 5 message outlived its Message Expiry Interval. Deadlines are kept
+ * in a TimingWheel, so recording stays O(1) and expire() only visits the
+ * topics that come due.
+ */
+class TopicTree
+{
+public:
+    struct Node
+    {
+        Node *parent = nullptr;
+        std::string name;
+        std::uint32_t id = 0;
+        std::uint32_t row = 0;
+        std::vector<Node *> children;
+        // name lookup, only built once a node has many children
+        std::unique_ptr<std::unordered_map<std::string, Node *>> index;
+
+        mqtt::const_message_ptr message;
+        TopicStats stats;
+        // rollup of stats over the whole subtree, valid while !dirty
+        TopicStats subtree;
+        bool dirty = false;
+        // created or recorded since the last take_touched()
+        bool touched = false;
+        // resync round that last recorded or confirmed the message
+        std::uint32_t generation = 0;
+        // the broker holds a retained message for the topic, as far as seen: set by
+        // any retained delivery, kept by live ones (RETAIN=0), cleared by an empty retained one
+        bool retained = false;
+        // its retained message was not replayed by the last resync
+        bool stale = false;
+        // nothing recorded within the idle expiry, or the message expired
+        bool expired = false;
+    };
+
+    // notified around every node creation, e.g. to keep a model in sync
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void node_adding(Node *parent, int row) = 0;
+        virtual void node_added(Node *node) = 0;
+    };
+
+    TopicTree();
+
+    Node *root() { return &nodes.front(); }
+    const Node *root() const { return &nodes.front(); }
+    Node *node(std::uint32_t id) { return &nodes[id]; }
+    std::size_t size() const { return nodes.size(); }
+
+    void set_listener(Listener *listener) { this->listener = listener; }
+
+    Node *find(const std::string &topic);
+    Node *insert(const std::string &topic);
+    Node *record(mqtt::const_message_ptr msg, double now);
+    // child of parent by name, created if missing
+    Node *insert(Node *parent, const std::string &name);
+    // puts back a node's message and statistics as they were, e.g. from a snapshot
+    void restore(Node *node, mqtt::const_message_ptr msg, const TopicStats &stats);
+    // room for that many topics with a message, e.g. before a bulk load
+    void reserve(std::size_t topics);
+    // ids of the nodes created or recorded since the last call, ascending
+    std::vector<std::uint32_t> take_touched();
+
+    // after the broker lost the session: messages recorded or confirmed from
+    // now on are current, retained topics that are neither by end_resync() are stale
+    void begin_resync();
+    // the broker replayed the node's retained message unchanged
+    void confirm(Node *node);
+    // marks the retained topics not seen since begin_resync(); returns how many
+    std::size_t end_resync();
+
+    // seconds without a message before a topic expires, 0 for never; reschedules every topic
+    void set_idle_expiry(double seconds);
+    double idle_expiry() const { return idle; }
+    // marks the topics that came due by now; returns how many
+    std::size_t expire(double now);
+    std::size_t expired() const { return expired_count; }
+
+    // rollup of the subtree below node, only recomputed where it changed
+    const TopicStats &subtree_stats(Node *node, double now);
+    std::string path(const Node *node) const;
+
+private:
+    static constexpr std::size_t INDEX_THRESHOLD = 8;
+    static constexpr double EXPIRY_TICK = 0.25;
+
+    struct FlatSlot
+    {
+        // 0 is empty, the root never holds a message
+        std::uint32_t id = 0;
+        // upper hash bits, also the probe start, so growing never touches a node
+        std::uint32_t tag = 0;
+    };
+
+    Node *child(Node *parent, const std::string &name) const;
+    Node *add_child(Node *parent, std::string name);
+    void mark_dirty(Node *node);
+    void touch(Node *node);
+    // deadline of the node's message, recorded at seen; no longer expired till then
+    void schedule(Node *node, double seen);
+    Node *flat_find(const std::string &topic, std::size_t hash);
+    void flat_insert(const Node *node, std::size_t hash);
+    void flat_grow(std::size_t capacity);
+
+    // allocated by the first message; the initial tree of the model is usually
+    // replaced by a synced or restored one before it gets any
+    static const std::size_t FLAT_INITIAL = 1024;
+
+    std::deque<Node> nodes;
+    // at most half full
+    std::vector<FlatSlot> flat;
+    std::size_t flat_used = 0;
+    std::vector<std::uint32_t> touched;
+    std::uint32_t generation = 0;
+    double idle = 0;
+    TimingWheel deadlines;
+    std::vector<std::uint32_t> due;
+    std::size_t expired_count = 0;
+    Listener *listener = nullptr;
+};
+
+#endif // TOPICTREE_H
@@ -0,0 +1,166 @@
+#include "toptalkers.h"
+#include <algorithm>
+#include <cmath>
+
+SpaceSaving::SpaceSaving(std::size_t capacity):
+    capacity(std::max<std::size_t>(capacity, 1))
+{
+    slots.reserve(this->capacity);
+    heap.reserve(this->capacity);
+    position.reserve(this->capacity);
+    slot_of.reserve(this->capacity * 2);
+}
+
+void SpaceSaving::swap_heap(std::size_t a, std::size_t b)
+{
+    std::swap(heap[a], heap[b]);
+    position[heap[a]] = a;
+    position[heap[b]] = b;
+}
+
+void SpaceSaving::sift_up(std::size_t at)
+{
+    while (at > 0) {
+        const std::size_t up = (at - 1) / 2;
+        if (slots[heap[up]].count <= slots[heap[at]].count)
+            break;
+        swap_heap(at, up);
+        at = up;
+    }
+}
+
+void SpaceSaving::sift_down(std::size_t at)
+{
+    for (;;) {
+        std::size_t smallest = at;
+        const std::size_t l = 2 * at + 1, r = l + 1;
+        if (l < heap.size() && slots[heap[l]].count < slots[heap[smallest]].count)
+            smallest = l;
+        if (r < heap.size() && slots[heap[r]].count < slots[heap[smallest]].count)
+            smallest = r;
+        if (smallest == at)
+            return;
+        swap_heap(at, smallest);
+        at = smallest;
+    }
+}
+
+void SpaceSaving::add(std::uint64_t key, const char *label, std::size_t length, double weight)
+{
+    auto it = slot_of.find(key);
+    if (it != slot_of.end()) {
+        slots[it->second].count += weight;
+        sift_down(position[it->second]);
+        return;
+    }
+
+    if (slots.size() < capacity) {
+        const std::size_t slot = slots.size();
+        slots.push_back(Entry{key, std::string(label, length), weight, 0});
+        heap.push_back(slot);
+        position.push_back(heap.size() - 1);
+        slot_of.emplace(key, slot);
+        sift_up(heap.size() - 1);
+        return;
+    }
+
+    // evict the minimum, the newcomer may have been counted that often already
+    const std::size_t slot = heap.front();
+    Entry &e = slots[slot];
+    slot_of.erase(e.key);
+    e.key = key;
+    e.label.assign(label, length);
+    e.error = e.count;
+    e.count += weight;
+    slot_of.emplace(key, slot);
+    sift_down(0);
+}
+
+void SpaceSaving::scale(double factor)
+{
+    for (Entry &e : slots) {
+        e.count *= factor;
+        e.error *= factor;
+    }
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::top(std::size_t k) const
+{
+    std::vector<Entry> result(slots);
+    const std::size_t n = std::min(k, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+                      [](const Entry &a, const Entry &b) { return a.count > b.count; });
+    result.resize(n);
+    return result;
+}
+
+TopTalkers::TopTalkers(std::size_t capacity)
+{
+    for (int i = 0; i < 4; ++i)
+        sketches.emplace_back(capacity);
+}
+
+SpaceSaving &TopTalkers::sketch(Scope scope, Metric metric)
+{
+    return sketches[(scope == Scope::Subtrees ? 2 : 0) + (metric == Metric::Bytes ? 1 : 0)];
+}
+
+const SpaceSaving &TopTalkers::sketch(Scope scope, Metric metric) const
+{
+    return sketches[(scope == Scope::Subtrees ? 2 : 0) + (metric == Metric::Bytes ? 1 : 0)];
+}
+
+void TopTalkers::record(const std::string &topic, std::size_t bytes, double now)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    add(topic, bytes, now);
+}
+
+void TopTalkers::record(const mqtt::const_message_ptr *msgs, std::size_t n, double now)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (std::size_t i = 0; i < n; ++i)
+        add(msgs[i]->get_topic(), msgs[i]->get_payload().size(), now);
+}
+
+void TopTalkers::add(const std::string &topic, std::size_t bytes, double now)
+{
+    if (!started) {
+        landmark = now;
+        started = true;
+    }
+    // forward decay: weigh new arrivals up instead of decaying every counter
+    if (now - landmark > 20 * TAU) {
+        const double factor = std::exp(-(now - landmark) / TAU);
+        for (SpaceSaving &s : sketches)
+            s.scale(factor);
+        landmark = now;
+    }
+    const double weight = std::exp((now - landmark) / TAU);
+
+    SpaceSaving &subtree_messages = sketch(Scope::Subtrees, Metric::Messages);
+    SpaceSaving &subtree_bytes = sketch(Scope::Subtrees, Metric::Bytes);
+
+    // FNV-1a over the topic, every level separator closes a subtree prefix
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < topic.size(); ++i) {
+        if (topic[i] == '/' && i > 0) {
+            subtree_messages.add(hash, topic.data(), i, weight);
+            subtree_bytes.add(hash, topic.data(), i, weight * bytes);
+        }
+        hash = (hash ^ static_cast<unsigned char>(topic[i])) * 1099511628211ull;
+    }
+    sketch(Scope::Topics, Metric::Messages).add(hash, topic.data(), topic.size(), weight);
+    sketch(Scope::Topics, Metric::Bytes).add(hash, topic.data(), topic.size(), weight * bytes);
+}
+
+std::vector<TopTalkers::Talker> TopTalkers::top(Scope scope, Metric metric, std::size_t k, double now) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const double factor = std::exp(-(now - landmark) / TAU) / TAU;
+
+    std::vector<Talker> result;
+    for (SpaceSaving::Entry &e : sketch(scope, metric).top(k))
+        result.push_back(Talker{std::move(e.label), e.count * factor, e.error * factor});
+    return result;
+}
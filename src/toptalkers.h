@@ -0,0 +1,89 @@
+#ifndef TOPTALKERS_H
+#define TOPTALKERS_H
+
+#include <mqtt/message.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Weighted Space-Saving sketch over 64 bit keys.
+ *
+ * Keeps at most `capacity` counters; an unseen key evicts the smallest
+ * one and inherits its count as error bound. Counters sit in a min-heap,
+ * so an update is O(log capacity), i.e. constant for the fixed capacity.
+ */
+class SpaceSaving
+{
+public:
+    struct Entry
+    {
+        std::uint64_t key;
+        std::string label;
+        double count;
+        double error;
+    };
+
+    explicit SpaceSaving(std::size_t capacity);
+
+    void add(std::uint64_t key, const char *label, std::size_t length, double weight);
+    void scale(double factor);
+    std::vector<Entry> top(std::size_t k) const;
+
+private:
+    void sift_down(std::size_t at);
+    void sift_up(std::size_t at);
+    void swap_heap(std::size_t a, std::size_t b);
+
+    std::size_t capacity;
+    std::vector<Entry> slots;
+    // heap of slot indices ordered by count, and each slot's heap position
+    std::vector<std::size_t> heap;
+    std::vector<std::size_t> position;
+    std::unordered_map<std::uint64_t, std::size_t> slot_of;
+};
+
+/**
+ * Top talkers of the broker, by topic and by subtree.
+ *
+ * Fed from the paho thread, per message or per batch; every topic
+ * prefix counts towards the subtree sketches. Counts use forward decay
+ * with time constant TAU, so count / TAU reads as a per-second rate.
+ */
+class TopTalkers
+{
+public:
+    enum class Scope { Topics, Subtrees };
+    enum class Metric { Messages, Bytes };
+
+    struct Talker
+    {
+        std::string topic;
+        double rate;
+        // upper bound of the overestimation in rate
+        double error;
+    };
+
+    static constexpr double TAU = 10.0;
+
+    explicit TopTalkers(std::size_t capacity = 256);
+
+    void record(const std::string &topic, std::size_t bytes, double now);
+    void record(const mqtt::const_message_ptr *msgs, std::size_t n, double now);
+    std::vector<Talker> top(Scope scope, Metric metric, std::size_t k, double now) const;
+
+private:
+    void add(const std::string &topic, std::size_t bytes, double now);
+    SpaceSaving &sketch(Scope scope, Metric metric);
+    const SpaceSaving &sketch(Scope scope, Metric metric) const;
+
+    mutable std::mutex lock;
+    std::vector<SpaceSaving> sketches;
+    double landmark = 0;
+    bool started = false;
+};
+
+#endif // TOPTALKERS_H